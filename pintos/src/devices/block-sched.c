@@ -0,0 +1,227 @@
+#include "devices/block-sched.h"
+#include <debug.h>
+#include <string.h>
+#include "devices/timer.h"
+
+/* I/O schedulers.
+
+   Each block device that carries out requests itself, instead of
+   passing them on to another device, keeps them in a
+   block_queue.  Whenever the device is idle, its scheduler
+   chooses one request to dispatch, and block_queue_dispatch()
+   merges into the same transfer any other pending requests in
+   the same direction whose sectors are adjacent to it, so that a
+   run of small requests costs one device command.
+
+   - FIFO dispatches requests in arrival order.
+
+   - C-LOOK sweeps the disk in one direction.  It dispatches the
+     pending request with the lowest sector at or past the head,
+     wrapping around to the lowest sector overall when there is
+     none.
+
+   - Deadline is C-LOOK, except that a request that has waited
+     past its deadline goes first.  Reads, which usually have a
+     thread waiting for them, get a shorter deadline than writes.
+
+   No scheduler dispatches a request ahead of an earlier request
+   that overlaps it, unless both are reads, so reordering never
+   changes what a read returns or what ends up on disk. */
+
+/* How long a read or a write may wait, in timer ticks, before
+   the deadline scheduler dispatches it out of order. */
+#define READ_EXPIRE (TIMER_FREQ / 2)
+#define WRITE_EXPIRE (TIMER_FREQ * 5)
+
+/* Returns true if A and B have any sector in common. */
+static bool
+overlaps (const struct block_request *a, const struct block_request *b)
+{
+  return a->sector < b->sector + b->cnt && b->sector < a->sector + a->cnt;
+}
+
+/* Returns true if REQ, which is in Q, may be dispatched now,
+   that is, if no request that arrived before it overlaps it,
+   unless both are reads. */
+static bool
+may_dispatch (struct block_queue *q, const struct block_request *req)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&q->requests); e != &req->elem; e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      if ((r->write || req->write) && overlaps (r, req))
+        return false;
+    }
+  return true;
+}
+
+/* Chooses the request that arrived first. */
+static struct block_request *
+fifo_choose (struct block_queue *q)
+{
+  return list_entry (list_front (&q->requests), struct block_request, elem);
+}
+
+/* Chooses the next request in C-LOOK order. */
+static struct block_request *
+clook_choose (struct block_queue *q)
+{
+  struct block_request *ahead = NULL;
+  struct block_request *lowest = NULL;
+  struct list_elem *e;
+
+  for (e = list_begin (&q->requests); e != list_end (&q->requests);
+       e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+
+      if (!may_dispatch (q, r))
+        continue;
+      if (r->sector >= q->head && (ahead == NULL || r->sector < ahead->sector))
+        ahead = r;
+      if (lowest == NULL || r->sector < lowest->sector)
+        lowest = r;
+    }
+
+  /* The first request to arrive may always be dispatched, so
+     LOWEST is not null. */
+  return ahead != NULL ? ahead : lowest;
+}
+
+/* Chooses the request whose deadline passed longest ago, if
+   any, otherwise the next request in C-LOOK order. */
+static struct block_request *
+deadline_choose (struct block_queue *q)
+{
+  int64_t now = timer_ticks ();
+  struct block_request *expired = NULL;
+  struct list_elem *e;
+
+  for (e = list_begin (&q->requests); e != list_end (&q->requests);
+       e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+
+      if (r->deadline <= now
+          && (expired == NULL || r->deadline < expired->deadline)
+          && may_dispatch (q, r))
+        expired = r;
+    }
+
+  return expired != NULL ? expired : clook_choose (q);
+}
+
+const struct block_scheduler block_sched_fifo = {"fifo", fifo_choose};
+const struct block_scheduler block_sched_clook = {"clook", clook_choose};
+const struct block_scheduler block_sched_deadline =
+  {"deadline", deadline_choose};
+
+/* Returns the scheduler with the given NAME, or a null pointer
+   if there is none. */
+const struct block_scheduler *
+block_sched_find (const char *name)
+{
+  static const struct block_scheduler *schedulers[] =
+    {
+      &block_sched_fifo,
+      &block_sched_clook,
+      &block_sched_deadline,
+    };
+  size_t i;
+
+  for (i = 0; i < sizeof schedulers / sizeof *schedulers; i++)
+    if (!strcmp (name, schedulers[i]->name))
+      return schedulers[i];
+  return NULL;
+}
+
+/* Initializes Q as an empty queue. */
+void
+block_queue_init (struct block_queue *q)
+{
+  list_init (&q->requests);
+  q->head = 0;
+  q->request_cnt = 0;
+  q->dispatch_cnt = 0;
+  q->merge_cnt = 0;
+  q->seek_cnt = 0;
+}
+
+/* Adds REQ to Q. */
+void
+block_queue_add (struct block_queue *q, struct block_request *req)
+{
+  req->deadline = timer_ticks () + (req->write ? WRITE_EXPIRE : READ_EXPIRE);
+  list_push_back (&q->requests, &req->elem);
+  q->request_cnt++;
+}
+
+/* Removes the request that SCHED chooses from Q, which must not
+   be empty, along with any other pending requests that can be
+   merged with it, and puts them in BATCH in order of sector.
+   The requests in BATCH are all in the same direction and cover
+   consecutive sectors, no more than MAX_CNT of them unless the
+   chosen request by itself is bigger.  Returns the number of
+   sectors that BATCH covers. */
+size_t
+block_queue_dispatch (struct block_queue *q,
+                      const struct block_scheduler *sched,
+                      size_t max_cnt, struct list *batch)
+{
+  struct block_request *first;
+  block_sector_t start;
+  size_t cnt;
+  bool merged;
+
+  ASSERT (!list_empty (&q->requests));
+
+  first = sched->choose (q);
+  start = first->sector;
+  cnt = first->cnt;
+  list_remove (&first->elem);
+  list_push_back (batch, &first->elem);
+
+  do
+    {
+      struct list_elem *e;
+
+      merged = false;
+      for (e = list_begin (&q->requests); e != list_end (&q->requests);
+           e = list_next (e))
+        {
+          struct block_request *r = list_entry (e, struct block_request,
+                                                elem);
+
+          if (r->write != first->write || cnt + r->cnt > max_cnt
+              || !may_dispatch (q, r))
+            continue;
+
+          if (r->sector == start + cnt)
+            {
+              list_remove (&r->elem);
+              list_push_back (batch, &r->elem);
+            }
+          else if (r->sector + r->cnt == start)
+            {
+              list_remove (&r->elem);
+              list_push_front (batch, &r->elem);
+              start = r->sector;
+            }
+          else
+            continue;
+
+          cnt += r->cnt;
+          q->merge_cnt++;
+          merged = true;
+          break;
+        }
+    }
+  while (merged);
+
+  q->seek_cnt += start >= q->head ? start - q->head : q->head - start;
+  q->head = start + cnt;
+  q->dispatch_cnt++;
+  return cnt;
+}
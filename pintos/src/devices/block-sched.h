@@ -0,0 +1,46 @@
+#ifndef DEVICES_BLOCK_SCHED_H
+#define DEVICES_BLOCK_SCHED_H
+
+#include <list.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Requests waiting for a block device, and statistics about how
+   they have been dispatched to the driver. */
+struct block_queue
+  {
+    struct list requests;               /* Pending, in arrival order. */
+    block_sector_t head;                /* Sector after last dispatched. */
+
+    unsigned long long request_cnt;     /* Requests added. */
+    unsigned long long dispatch_cnt;    /* Driver transfers issued. */
+    unsigned long long merge_cnt;       /* Requests merged into another's
+                                           transfer. */
+    unsigned long long seek_cnt;        /* Sum of sectors between the end
+                                           of a transfer and the start
+                                           of the next. */
+  };
+
+/* A policy for ordering a queue's requests. */
+struct block_scheduler
+  {
+    const char *name;
+
+    /* Returns the request in the queue to dispatch next.  The
+       queue is not empty. */
+    struct block_request *(*choose) (struct block_queue *);
+  };
+
+extern const struct block_scheduler block_sched_fifo;
+extern const struct block_scheduler block_sched_clook;
+extern const struct block_scheduler block_sched_deadline;
+
+const struct block_scheduler *block_sched_find (const char *name);
+
+void block_queue_init (struct block_queue *);
+void block_queue_add (struct block_queue *, struct block_request *);
+size_t block_queue_dispatch (struct block_queue *,
+                             const struct block_scheduler *,
+                             size_t max_cnt, struct list *batch);
+
+#endif /* devices/block-sched.h */
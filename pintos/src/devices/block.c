@@ -2,8 +2,13 @@
 #include <list.h>
 #include <string.h>
 #include <stdio.h>
+#include "devices/block-sched.h"
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* A block device. */
 struct block
@@ -17,10 +22,31 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    /* Statistics, and the lock that protects them. */
+    struct block_stats stats;
+    struct lock stats_lock;
+    block_sector_t next_sector;         /* Sector after last request's. */
+    unsigned depth;                     /* Requests outstanding. */
+
+    struct block *parent;               /* Device this is a partition of,
+                                           or null. */
+
+    /* Requests waiting to be carried out, the scheduler that
+       orders them, the lock that protects both, and a condition
+       signaled when a request is added.  The queue's thread is
+       created on first use. */
+    struct block_queue queue;
+    const struct block_scheduler *sched;
+    struct lock queue_lock;
+    struct condition queue_changed;
+    bool queue_thread_started;
   };
 
+/* Most pages of sectors that the queue thread merges into a
+   single transfer. */
+#define MERGE_PAGES 8
+#define MERGE_CNT (MERGE_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+
 /* List of all block devices. */
 static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 
@@ -28,6 +54,14 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void transfer (struct block *, bool write, block_sector_t, size_t cnt,
+                      void *buffer);
+static void sync_transfer (struct block *, bool write, block_sector_t,
+                           size_t cnt, void *buffer);
+static void queue_thread (void *block_);
+static void stats_submit (struct block *, bool write, block_sector_t,
+                          size_t cnt);
+static void stats_complete (struct block *, int64_t service_ns);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -121,8 +155,7 @@ void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  sync_transfer (block, false, sector, 1, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -135,8 +168,292 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  sync_transfer (block, true, sector, 1, (void *) buffer);
+}
+
+/* Verifies that the CNT sectors starting at SECTOR are all
+   within BLOCK.  Panics if not. */
+static void
+check_sectors (struct block *block, block_sector_t sector, size_t cnt)
+{
+  ASSERT (cnt > 0);
+  check_sector (block, sector);
+  if (cnt > block->size - sector)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", cnt=%zu, "
+           "size=%"PRDSNu")\n", block_name (block), sector, cnt,
+           block->size);
+}
+
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  If BLOCK's driver supports it, this takes a single
+   device command instead of one per sector.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                     void *buffer)
+{
+  check_sectors (block, sector, cnt);
+  sync_transfer (block, false, sector, cnt, buffer);
+}
+
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving the
+   data.  If BLOCK's driver supports it, this takes a single
+   device command instead of one per sector.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector, size_t cnt,
+                      const void *buffer)
+{
+  check_sectors (block, sector, cnt);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  sync_transfer (block, true, sector, cnt, (void *) buffer);
+}
+
+/* Carries out a transfer for block_read() and the like, and
+   waits for it.  The transfer goes through BLOCK's queue, so
+   that the scheduler can order it among, and merge it with,
+   other threads' requests.  A BUFFER outside kernel memory
+   cannot be handed to the queue's thread, so in that case the
+   transfer is done directly instead. */
+static void
+sync_transfer (struct block *block, bool write, block_sector_t sector,
+               size_t cnt, void *buffer)
+{
+  if (is_kernel_vaddr (buffer))
+    {
+      struct block_request req;
+
+      block_request_init (&req, write, sector, cnt, buffer, NULL, NULL);
+      block_submit (block, &req);
+      block_wait (&req);
+    }
+  else
+    {
+      int64_t start = timer_ns ();
+
+      stats_submit (block, write, sector, cnt);
+      transfer (block, write, sector, cnt, buffer);
+      stats_complete (block, timer_ns () - start);
+    }
+}
+
+/* Carries out a transfer of CNT sectors starting at SECTOR
+   between BLOCK and BUFFER, in the direction given by WRITE, with
+   BLOCK's driver operations. */
+static void
+transfer (struct block *block, bool write, block_sector_t sector, size_t cnt,
+          void *buffer_)
+{
+  const struct block_operations *ops = block->ops;
+  uint8_t *buffer = buffer_;
+  size_t i;
+
+  if (write && ops->write_multiple != NULL)
+    ops->write_multiple (block->aux, sector, cnt, buffer);
+  else if (!write && ops->read_multiple != NULL)
+    ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      {
+        if (write)
+          ops->write (block->aux, sector + i, buffer + i * BLOCK_SECTOR_SIZE);
+        else
+          ops->read (block->aux, sector + i, buffer + i * BLOCK_SECTOR_SIZE);
+      }
+}
+
+/* Initializes REQ as a request to transfer CNT sectors starting
+   at SECTOR between a block device and BUFFER: from the device
+   into BUFFER if WRITE is false, or from BUFFER to the device if
+   WRITE is true.  BUFFER must be in kernel memory, because the
+   transfer may be carried out by another thread.
+
+   When the request completes, COMPLETE is called with REQ, if it
+   is non-null.  It may be called in another thread, or before
+   block_submit() returns.  If COMPLETE is null, wait for the
+   request with block_wait() instead. */
+void
+block_request_init (struct block_request *req, bool write,
+                    block_sector_t sector, size_t cnt, void *buffer,
+                    block_complete_func *complete, void *aux)
+{
+  ASSERT (cnt > 0);
+  ASSERT (is_kernel_vaddr (buffer));
+
+  req->write = write;
+  req->sector = sector;
+  req->cnt = cnt;
+  req->buffer = buffer;
+  req->complete = complete;
+  req->aux = aux;
+  req->origin = NULL;
+  sema_init (&req->done, 0);
+}
+
+/* Submits REQ to BLOCK and returns without waiting for it to
+   complete.  Requests to a device are carried out in the order
+   chosen by its scheduler, which never reorders a write with
+   another request for any of the same sectors.  A driver may
+   translate REQ->SECTOR as it passes REQ down to another
+   device. */
+void
+block_submit (struct block *block, struct block_request *req)
+{
+  check_sectors (block, req->sector, req->cnt);
+  ASSERT (!req->write || block->type != BLOCK_FOREIGN);
+
+  if (req->origin == NULL)
+    {
+      req->origin = block;
+      req->submitted = timer_ns ();
+    }
+  stats_submit (block, req->write, req->sector, req->cnt);
+
+  if (block->ops->submit != NULL)
+    {
+      block->ops->submit (block->aux, req);
+      return;
+    }
+
+  lock_acquire (&block->queue_lock);
+  if (!block->queue_thread_started)
+    {
+      char name[sizeof block->name + 4];
+
+      snprintf (name, sizeof name, "%s-io", block->name);
+      if (thread_create (name, PRI_DEFAULT, queue_thread, block) == TID_ERROR)
+        PANIC ("%s: failed to start I/O thread", block->name);
+      block->queue_thread_started = true;
+    }
+  block_queue_add (&block->queue, req);
+  cond_signal (&block->queue_changed, &block->queue_lock);
+  lock_release (&block->queue_lock);
+}
+
+/* Waits for REQ, which must have been submitted without a
+   completion function, to complete. */
+void
+block_wait (struct block_request *req)
+{
+  ASSERT (req->complete == NULL);
+
+  sema_down (&req->done);
+}
+
+/* Carries out the requests in BATCH, which cover CNT
+   consecutive sectors in the same direction, as a single transfer
+   through MERGE_BUFFER. */
+static void
+transfer_merged (struct block *block, struct list *batch, size_t cnt,
+                 uint8_t *merge_buffer)
+{
+  struct block_request *first = list_entry (list_front (batch),
+                                            struct block_request, elem);
+  struct list_elem *e;
+  uint8_t *p;
+
+  if (first->write)
+    for (e = list_begin (batch), p = merge_buffer; e != list_end (batch);
+         e = list_next (e))
+      {
+        struct block_request *r = list_entry (e, struct block_request, elem);
+        memcpy (p, r->buffer, r->cnt * BLOCK_SECTOR_SIZE);
+        p += r->cnt * BLOCK_SECTOR_SIZE;
+      }
+
+  transfer (block, first->write, first->sector, cnt, merge_buffer);
+
+  if (!first->write)
+    for (e = list_begin (batch), p = merge_buffer; e != list_end (batch);
+         e = list_next (e))
+      {
+        struct block_request *r = list_entry (e, struct block_request, elem);
+        memcpy (r->buffer, p, r->cnt * BLOCK_SECTOR_SIZE);
+        p += r->cnt * BLOCK_SECTOR_SIZE;
+      }
+}
+
+/* Carries out the requests queued for BLOCK_, in the order its
+   scheduler chooses, forever.  The driver's interrupt handler
+   wakes this thread whenever the device finishes a command, so
+   the caller of block_submit() is free to do other work, or to
+   submit more requests, meanwhile.  Adjacent requests are merged
+   into one transfer through a buffer of MERGE_CNT sectors; if the
+   buffer can't be allocated, requests are carried out one at a
+   time. */
+static void
+queue_thread (void *block_)
+{
+  struct block *block = block_;
+  uint8_t *merge_buffer = palloc_get_multiple (0, MERGE_PAGES);
+  size_t max_cnt = merge_buffer != NULL ? MERGE_CNT : 0;
+
+  for (;;)
+    {
+      struct list batch;
+      struct block_request *first;
+      size_t cnt;
+
+      list_init (&batch);
+      lock_acquire (&block->queue_lock);
+      while (list_empty (&block->queue.requests))
+        cond_wait (&block->queue_changed, &block->queue_lock);
+      cnt = block_queue_dispatch (&block->queue, block->sched, max_cnt,
+                                  &batch);
+      lock_release (&block->queue_lock);
+
+      first = list_entry (list_front (&batch), struct block_request, elem);
+      if (list_next (&first->elem) == list_end (&batch))
+        transfer (block, first->write, first->sector, cnt, first->buffer);
+      else
+        transfer_merged (block, &batch, cnt, merge_buffer);
+
+      /* A request may be freed as soon as it is complete, so it
+         must not be touched afterward. */
+      while (!list_empty (&batch))
+        block_complete (list_entry (list_pop_front (&batch),
+                                    struct block_request, elem));
+    }
+}
+
+/* Finishes REQ, which has been carried out: accounts for it on
+   every device that it passed through, then calls its completion
+   function or wakes up the thread waiting for it.  Called by the
+   block layer, or by a driver that carries out requests in its
+   submit operation.  REQ may be freed as soon as it is complete,
+   so the caller must not touch it afterward. */
+void
+block_complete (struct block_request *req)
+{
+  int64_t service_ns = timer_ns () - req->submitted;
+  struct block *b;
+
+  for (b = req->origin; b != NULL; b = b->parent)
+    stats_complete (b, service_ns);
+
+  if (req->complete != NULL)
+    req->complete (req);
+  else
+    sema_up (&req->done);
+}
+
+/* Makes BLOCK's requests be ordered by SCHED.  If BLOCK is a
+   partition, this applies to the whole device that it is part
+   of. */
+void
+block_set_scheduler (struct block *block, const struct block_scheduler *sched)
+{
+  while (block->parent != NULL)
+    block = block->parent;
+
+  lock_acquire (&block->queue_lock);
+  block->sched = sched;
+  lock_release (&block->queue_lock);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,10 +477,92 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Returns the histogram bucket that VALUE belongs in. */
+static int
+hist_bucket (unsigned long long value)
+{
+  int bucket = 0;
+
+  while (value > 0 && bucket < BLOCK_HIST_CNT - 1)
+    {
+      value >>= 1;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* Records that a request to transfer CNT sectors starting at
+   SECTOR, in the direction given by WRITE, has been submitted to
+   BLOCK. */
+static void
+stats_submit (struct block *block, bool write, block_sector_t sector,
+              size_t cnt)
+{
+  struct block_stats *s = &block->stats;
+
+  lock_acquire (&block->stats_lock);
+  if (write)
+    s->write_cnt += cnt;
+  else
+    s->read_cnt += cnt;
+  if (sector == block->next_sector)
+    s->sequential_cnt++;
+  block->next_sector = sector + cnt;
+  s->size_hist[hist_bucket (cnt)]++;
+  if (++block->depth > s->max_depth)
+    s->max_depth = block->depth;
+  lock_release (&block->stats_lock);
+}
+
+/* Records that a request submitted to BLOCK has completed,
+   SERVICE_NS nanoseconds after it was submitted. */
+static void
+stats_complete (struct block *block, int64_t service_ns)
+{
+  struct block_stats *s = &block->stats;
+
+  lock_acquire (&block->stats_lock);
+  ASSERT (block->depth > 0);
+  block->depth--;
+  s->request_cnt++;
+  s->service_ns += service_ns;
+  s->service_hist[hist_bucket (service_ns / 1000)]++;
+  lock_release (&block->stats_lock);
+}
+
+/* Prints histogram HIST, described by WHAT, for the device
+   called NAME, leaving out empty buckets. */
+static void
+print_hist (const char *name, const char *what,
+            const unsigned long long hist[BLOCK_HIST_CNT])
+{
+  int i;
+
+  printf ("%s: %s:", name, what);
+  for (i = 0; i < BLOCK_HIST_CNT; i++)
+    if (hist[i] > 0)
+      {
+        unsigned long long low = i > 0 ? 1ULL << (i - 1) : 0;
+        unsigned long long high = (1ULL << i) - 1;
+
+        if (i == BLOCK_HIST_CNT - 1)
+          printf (" %llu+:%llu", low, hist[i]);
+        else if (low == high)
+          printf (" %llu:%llu", low, hist[i]);
+        else
+          printf (" %llu-%llu:%llu", low, high, hist[i]);
+      }
+  printf ("\n");
+}
+
+/* Prints statistics for each block device used for a Pintos
+   role, and for the queue of each device that has had requests
+   queued.  Takes no locks, because it may be called while
+   shutting down after a kernel panic. */
 void
 block_print_stats (void)
 {
+  struct list_elem *e;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -171,11 +570,46 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
+          struct block_stats s = block->stats;
+
           printf ("%s (%s): %llu reads, %llu writes\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  s.read_cnt, s.write_cnt);
+          if (s.request_cnt == 0)
+            continue;
+
+          printf ("%s: %llu requests, %llu bytes, %llu%% sequential, "
+                  "%llu us in service, max queue depth %u\n",
+                  block->name, s.request_cnt,
+                  (s.read_cnt + s.write_cnt) * BLOCK_SECTOR_SIZE,
+                  s.sequential_cnt * 100 / s.request_cnt,
+                  s.service_ns / 1000, s.max_depth);
+          print_hist (block->name, "service us", s.service_hist);
+          print_hist (block->name, "request sectors", s.size_hist);
         }
     }
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    {
+      struct block *block = list_entry (e, struct block, list_elem);
+      struct block_queue *q = &block->queue;
+      if (block->queue_thread_started)
+        printf ("%s: %s scheduler, %llu requests in %llu transfers "
+                "(%llu merged), %llu sectors seeked\n",
+                block->name, block->sched->name, q->request_cnt,
+                q->dispatch_cnt, q->merge_cnt, q->seek_cnt);
+    }
+}
+
+/* Stores statistics for the requests that BLOCK has carried out
+   since it was registered in *STATS. */
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  lock_acquire (&block->stats_lock);
+  *stats = block->stats;
+  lock_release (&block->stats_lock);
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -198,8 +632,16 @@ block_register (const char *name, enum block_type type,
   block->size = size;
   block->ops = ops;
   block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
+  lock_init (&block->stats_lock);
+  block->next_sector = 0;
+  block->depth = 0;
+  block->parent = NULL;
+  block_queue_init (&block->queue);
+  block->sched = &block_sched_clook;
+  lock_init (&block->queue_lock);
+  cond_init (&block->queue_changed);
+  block->queue_thread_started = false;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -211,6 +653,14 @@ block_register (const char *name, enum block_type type,
   return block;
 }
 
+/* Records that BLOCK is a partition of PARENT, so that
+   scheduling BLOCK means scheduling PARENT. */
+void
+block_set_parent (struct block *block, struct block *parent)
+{
+  block->parent = parent;
+}
+
 /* Returns the block device corresponding to LIST_ELEM, or a null
    pointer if LIST_ELEM is the list end of all_blocks. */
 static struct block *
@@ -1,8 +1,11 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <block-stats.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include <list.h>
+#include "threads/synch.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,11 +56,55 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multiple (struct block *, block_sector_t, size_t cnt,
+                          void *);
+void block_write_multiple (struct block *, block_sector_t, size_t cnt,
+                           const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests. */
+
+struct block_request;
+
+/* Called when a request completes. */
+typedef void block_complete_func (struct block_request *);
+
+/* A request to read or write consecutive sectors, submitted with
+   block_submit().  The caller owns the request and must keep it
+   alive until it completes. */
+struct block_request
+  {
+    /* Set by block_request_init(). */
+    bool write;                         /* Write (true) or read (false)? */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    void *buffer;                       /* Data, in kernel memory. */
+    block_complete_func *complete;      /* Completion function, or null. */
+    void *aux;                          /* For COMPLETE's use. */
+
+    /* Owned by the block layer. */
+    struct list_elem elem;              /* In a device's queue. */
+    int64_t deadline;                   /* When to stop deferring it. */
+    struct block *origin;               /* Device first submitted to. */
+    int64_t submitted;                  /* timer_ns() when submitted. */
+    struct semaphore done;              /* Up'd on completion if COMPLETE
+                                           is null. */
+  };
+
+void block_request_init (struct block_request *, bool write,
+                         block_sector_t, size_t cnt, void *buffer,
+                         block_complete_func *, void *aux);
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+
+/* Scheduling. */
+struct block_scheduler;
+void block_set_scheduler (struct block *, const struct block_scheduler *);
+
 /* Statistics. */
 void block_print_stats (void);
+void block_get_stats (struct block *, struct block_stats *);
 
 /* Lower-level interface to block device drivers. */
 
@@ -65,10 +112,27 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Transfer CNT consecutive sectors at once.  Optional: if
+       null, the block layer calls read or write once per
+       sector. */
+    void (*read_multiple) (void *aux, block_sector_t, size_t cnt,
+                           void *buffer);
+    void (*write_multiple) (void *aux, block_sector_t, size_t cnt,
+                            const void *buffer);
+
+    /* Passes an asynchronous request on to another block device,
+       after adjusting its sector, or carries it out directly and
+       calls block_complete().  Optional: if null, the block layer
+       queues the request and carries it out with the operations
+       above in a thread of its own. */
+    void (*submit) (void *aux, struct block_request *);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
+void block_set_parent (struct block *, struct block *parent);
+void block_complete (struct block_request *);
 
 #endif /* devices/block.h */
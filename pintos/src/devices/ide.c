@@ -4,14 +4,24 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include "devices/block.h"
+#include <string.h>
 #include "devices/partition.h"
+#include "devices/pci.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   If the controller is a PCI IDE controller that can act as a bus
+   master, as the PIIX that QEMU emulates can, data is moved by
+   DMA, which leaves the CPU free during transfers.  Otherwise, or
+   if a DMA transfer fails, data is moved by PIO through the data
+   register. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -30,10 +40,25 @@
 #define reg_ctl(CHANNEL) ((CHANNEL)->reg_base + 0x206)  /* Control (w/o). */
 #define reg_alt_status(CHANNEL) reg_ctl (CHANNEL)       /* Alt Status (r/o). */
 
+/* Bus master IDE port addresses, for channels that support
+   DMA. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRDT address. */
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus master Status Register bits. */
+#define BM_STA_ERR 0x02         /* Error (write 1 to clear). */
+#define BM_STA_INTR 0x04        /* Interrupt (write 1 to clear). */
+
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +74,15 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Most sectors that a single read or write command can
+   transfer.  A sector count of 0 in reg_nsect means 256. */
+#define MAX_CMD_SECTORS 256
 
 /* An ATA device. */
 struct ata_disk
@@ -57,8 +91,34 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple;               /* Sectors per interrupt for READ and
+                                   WRITE MULTIPLE, or 0 to transfer one
+                                   sector per interrupt instead. */
+    bool dma;                   /* Transfer data by DMA? */
+  };
+
+/* A physical region descriptor, which tells the bus master where
+   in physical memory to transfer part of the data for a DMA
+   command.  A region may not cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT for the last region. */
   };
 
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Most regions that one DMA command needs: MAX_CMD_SECTORS
+   sectors span at most three 64 kB boundaries. */
+#define PRDT_CNT 4
+
+/* Size of each channel's bounce buffer, used for DMA to and from
+   buffers that are not in kernel memory and thus may not be
+   physically contiguous. */
+#define BOUNCE_PAGES 4
+#define BOUNCE_SECTORS (BOUNCE_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+
 /* An ATA channel (aka controller).
    Each channel can control up to two disks. */
 struct channel
@@ -72,21 +132,49 @@ struct channel
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master base port, or 0 if no DMA. */
+    uint8_t *bounce;            /* Bounce buffer for DMA. */
+    struct prd prdt[PRDT_CNT]   /* Physical region descriptor table.  The */
+      __attribute__ ((aligned (32)));   /* alignment keeps it from
+                                           crossing a 64 kB boundary. */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
+
+    /* Statistics. */
+    unsigned long long transfer_cnt;    /* Transfers carried out. */
+    unsigned long long overlap_cnt;     /* Transfers started while another
+                                           channel was busy. */
   };
 
 /* We support the two "legacy" ATA channels found in a standard PC. */
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Number of channels in the middle of a transfer.  The channels
+   work independently, so a disk on one can seek and transfer
+   while a disk on the other does too. */
+static int busy_channels;
+
 static struct block_operations ide_operations;
+static void ide_read_multiple (void *, block_sector_t, size_t, void *);
+static void ide_write_multiple (void *, block_sector_t, size_t,
+                                const void *);
 
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
-
-static void select_sector (struct ata_disk *, block_sector_t);
-static void issue_pio_command (struct channel *, uint8_t command);
+static void set_multiple_mode (struct ata_disk *, int sectors);
+
+static uint16_t find_bus_master (void);
+
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
+static bool dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          void *buffer, bool write);
+static void pio_read (struct ata_disk *, block_sector_t, size_t cnt,
+                      void *buffer);
+static void pio_write (struct ata_disk *, block_sector_t, size_t cnt,
+                       const void *buffer);
+static void issue_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
@@ -96,11 +184,14 @@ static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static void channel_begin (struct channel *);
+static void channel_end (struct channel *);
 
 /* Initialize the disk subsystem and detect disks. */
 void
 ide_init (void) 
 {
+  uint16_t bm_base = find_bus_master ();
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -126,6 +217,19 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->transfer_cnt = 0;
+      c->overlap_cnt = 0;
+
+      /* Set up DMA.  The secondary channel's bus master registers
+         follow the primary's. */
+      c->bm_base = 0;
+      c->bounce = NULL;
+      if (bm_base != 0)
+        {
+          c->bounce = palloc_get_multiple (0, BOUNCE_PAGES);
+          if (c->bounce != NULL)
+            c->bm_base = bm_base + chan_no * 8;
+        }
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +240,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 0;
+          d->dma = false;
         }
 
       /* Register interrupt handler. */
@@ -272,7 +378,7 @@ identify_ata_device (struct ata_disk *d)
      indicating the device's response is ready, and read the data
      into our buffer. */
   select_device_wait (d);
-  issue_pio_command (c, CMD_IDENTIFY_DEVICE);
+  issue_command (c, CMD_IDENTIFY_DEVICE);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     {
@@ -303,12 +409,70 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* Transfer as many sectors per interrupt as the disk allows.
+     Word 47 gives the most it supports in its low byte. */
+  set_multiple_mode (d, (uint8_t) id[47 * 2]);
+
+  /* Use DMA if both the channel and the disk support it.  Bit 8
+     of word 49 says whether the disk does. */
+  d->dma = d->channel->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
+  if (d->dma)
+    strlcat (extra_info, ", DMA", sizeof extra_info);
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
   partition_scan (block);
 }
 
+/* Tells disk D to transfer SECTORS sectors per interrupt in READ
+   and WRITE MULTIPLE commands, and sets D's multiple member to
+   SECTORS if the disk accepts, or to 0 otherwise. */
+static void
+set_multiple_mode (struct ata_disk *d, int sectors)
+{
+  struct channel *c = d->channel;
+
+  d->multiple = 0;
+  if (sectors <= 1)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), sectors);
+  issue_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_status (c)) & STA_ERR) == 0)
+    d->multiple = sectors;
+}
+
+/* Looks for a PCI IDE controller that can act as a bus master.
+   If one is found, enables bus mastering on it and returns the
+   base I/O port of its bus master registers.  Otherwise, returns
+   0. */
+static uint16_t
+find_bus_master (void) 
+{
+  struct pci_dev pd;
+  uint32_t bar;
+
+  /* Class 1 is mass storage, subclass 1 is IDE.  Bit 7 of the
+     programming interface says whether it can be a bus master. */
+  if (!pci_find_class (0x01, 0x01, &pd)
+      || !(pci_read_config (&pd, PCI_REG_CLASS) & 0x8000))
+    return 0;
+
+  /* BAR 4 holds the bus master registers' I/O base. */
+  bar = pci_read_config (&pd, PCI_REG_BAR0 + 4 * 4);
+  if (!(bar & 1) || (bar & ~3u) == 0)
+    return 0;
+
+  pci_write_config (&pd, PCI_REG_COMMAND,
+                    (pci_read_config (&pd, PCI_REG_COMMAND)
+                     | PCI_CMD_IO | PCI_CMD_MASTER));
+  return bar & 0xfffc;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -342,58 +506,255 @@ descramble_ata_string (char *string, int size)
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write (void *d, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multiple (d, sec_no, 1, buffer);
+}
+
+/* Returns the number of sectors of a CNT-sector transfer for
+   disk D to or from BUFFER to do in one command. */
+static size_t
+cmd_sectors (const struct ata_disk *d, const void *buffer, size_t cnt)
+{
+  if (cnt > MAX_CMD_SECTORS)
+    cnt = MAX_CMD_SECTORS;
+  if (d->dma && !is_kernel_vaddr (buffer) && cnt > BOUNCE_SECTORS)
+    cnt = BOUNCE_SECTORS;
+  return cnt;
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Issues
+   one command per MAX_CMD_SECTORS sectors, by DMA if possible.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                   void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  channel_begin (c);
+  while (cnt > 0)
+    {
+      size_t cmd_cnt = cmd_sectors (d, buffer, cnt);
+
+      if (!d->dma || !dma_transfer (d, sec_no, cmd_cnt, buffer, false))
+        pio_read (d, sec_no, cmd_cnt, buffer);
+      sec_no += cmd_cnt;
+      buffer += cmd_cnt * BLOCK_SECTOR_SIZE;
+      cnt -= cmd_cnt;
+    }
+  channel_end (c);
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving the data.  Issues
+   commands as ide_read_multiple() does.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  const uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  channel_begin (c);
+  while (cnt > 0)
+    {
+      size_t cmd_cnt = cmd_sectors (d, buffer, cnt);
+
+      if (!d->dma
+          || !dma_transfer (d, sec_no, cmd_cnt, (void *) buffer, true))
+        pio_write (d, sec_no, cmd_cnt, buffer);
+      sec_no += cmd_cnt;
+      buffer += cmd_cnt * BLOCK_SECTOR_SIZE;
+      cnt -= cmd_cnt;
+    }
+  channel_end (c);
   lock_release (&c->lock);
 }
 
+/* Reads CNT sectors, at most MAX_CMD_SECTORS, starting at SEC_NO
+   from disk D into BUFFER with a single PIO command.  Takes an
+   interrupt per D->multiple sectors if D supports READ MULTIPLE,
+   or per sector otherwise.  D's channel must be locked. */
+static void
+pio_read (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          void *buffer_)
+{
+  struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+  size_t per_intr = d->multiple > 0 ? d->multiple : 1;
+  size_t i;
+
+  select_sector (d, sec_no, cnt);
+  issue_command (c, (d->multiple > 0
+                     ? CMD_READ_MULTIPLE
+                     : CMD_READ_SECTOR_RETRY));
+  for (i = 0; i < cnt; i++)
+    {
+      /* The disk interrupts when each block of sectors is
+         ready. */
+      if (i % per_intr == 0)
+        {
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+        }
+      input_sector (c, buffer);
+      buffer += BLOCK_SECTOR_SIZE;
+    }
+}
+
+/* Writes CNT sectors, at most MAX_CMD_SECTORS, starting at SEC_NO
+   to disk D from BUFFER with a single PIO command, interrupting as
+   pio_read() does.  D's channel must be locked. */
+static void
+pio_write (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+           const void *buffer_)
+{
+  struct channel *c = d->channel;
+  const uint8_t *buffer = buffer_;
+  size_t per_intr = d->multiple > 0 ? d->multiple : 1;
+  size_t i;
+
+  select_sector (d, sec_no, cnt);
+  issue_command (c, (d->multiple > 0
+                     ? CMD_WRITE_MULTIPLE
+                     : CMD_WRITE_SECTOR_RETRY));
+  for (i = 0; i < cnt; i++)
+    {
+      /* The disk asks for each block of sectors, then interrupts
+         once it has taken it. */
+      if (i % per_intr == 0 && !wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu,
+               d->name, sec_no + i);
+      output_sector (c, buffer);
+      buffer += BLOCK_SECTOR_SIZE;
+      if (i % per_intr == per_intr - 1 || i == cnt - 1)
+        sema_down (&c->completion_wait);
+    }
+}
+
+/* Transfers CNT sectors, at most MAX_CMD_SECTORS, starting at
+   SEC_NO between disk D and BUFFER by DMA: from BUFFER to the disk
+   if WRITE is true, otherwise from the disk into BUFFER.  BUFFER
+   is used directly if it is in kernel memory, which is physically
+   contiguous, or through the channel's bounce buffer otherwise,
+   in which case CNT may be at most BOUNCE_SECTORS.
+   Returns true if successful.  On failure, turns off DMA for D
+   and returns false, so that the caller can fall back to PIO.
+   D's channel must be locked. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              void *buffer, bool write)
+{
+  struct channel *c = d->channel;
+  bool bounce = !is_kernel_vaddr (buffer);
+  size_t size = cnt * BLOCK_SECTOR_SIZE;
+  uintptr_t paddr;
+  uint8_t direction = write ? 0 : BM_CMD_READ;
+  uint8_t bm_status, status;
+  struct prd *prd;
+
+  ASSERT (cnt > 0 && cnt <= MAX_CMD_SECTORS);
+  ASSERT (!bounce || cnt <= BOUNCE_SECTORS);
+
+  if (bounce && write)
+    memcpy (c->bounce, buffer, size);
+
+  /* Describe the physical memory to transfer, splitting it at
+     64 kB boundaries. */
+  paddr = vtop (bounce ? c->bounce : buffer);
+  for (prd = c->prdt; size > 0; prd++)
+    {
+      size_t region = 0x10000 - (paddr & 0xffff);
+      if (region > size)
+        region = size;
+      ASSERT (prd < c->prdt + PRDT_CNT);
+
+      prd->addr = paddr;
+      prd->size = region & 0xffff;
+      prd->flags = 0;
+      paddr += region;
+      size -= region;
+    }
+  prd[-1].flags = PRD_EOT;
+
+  /* Program the bus master, issue the command, and start the
+     transfer.  The disk interrupts when it is done. */
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c),
+        inb (reg_bm_status (c)) | BM_STA_ERR | BM_STA_INTR);
+  select_sector (d, sec_no, cnt);
+  issue_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), direction | BM_CMD_START);
+  sema_down (&c->completion_wait);
+
+  /* Stop the bus master and check for errors. */
+  outb (reg_bm_command (c), direction);
+  bm_status = inb (reg_bm_status (c));
+  outb (reg_bm_status (c), bm_status | BM_STA_ERR | BM_STA_INTR);
+  status = inb (reg_alt_status (c));
+  if ((bm_status & BM_STA_ERR) || (status & (STA_BSY | STA_ERR)))
+    {
+      printf ("%s: DMA failed, sector=%"PRDSNu", using PIO\n",
+              d->name, sec_no);
+      d->dma = false;
+      wait_while_busy (d);
+      return false;
+    }
+
+  if (bounce && !write)
+    memcpy (buffer, c->bounce, cnt * BLOCK_SECTOR_SIZE);
+  return true;
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple,
+    NULL                        /* Requests are queued by block.c. */
   };
-
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
+   writes SEC_NO and CNT, which must be between 1 and
+   MAX_CMD_SECTORS, to the disk's sector selection registers.  (We
    use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= MAX_CMD_SECTORS);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == MAX_CMD_SECTORS ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -404,7 +765,7 @@ select_sector (struct ata_disk *d, block_sector_t sec_no)
 /* Writes COMMAND to channel C and prepares for receiving a
    completion interrupt. */
 static void
-issue_pio_command (struct channel *c, uint8_t command) 
+issue_command (struct channel *c, uint8_t command) 
 {
   /* Interrupts must be enabled or our semaphore will never be
      up'd by the completion handler. */
@@ -525,3 +886,52 @@ interrupt_handler (struct intr_frame *f)
 }
 
 
+/* Marks channel C, which must be locked, as starting a
+   transfer, and counts the transfer as overlapped if another
+   channel is already busy. */
+static void
+channel_begin (struct channel *c)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  old_level = intr_disable ();
+  c->transfer_cnt++;
+  if (busy_channels > 0)
+    c->overlap_cnt++;
+  busy_channels++;
+  intr_set_level (old_level);
+}
+
+/* Marks channel C, which must be locked, as done with its
+   transfer. */
+static void
+channel_end (struct channel *c)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  old_level = intr_disable ();
+  ASSERT (busy_channels > 0);
+  busy_channels--;
+  intr_set_level (old_level);
+}
+
+/* Prints statistics for each channel that has carried out
+   transfers, including how many of them overlapped with a
+   transfer on the other channel. */
+void
+ide_print_stats (void)
+{
+  size_t chan_no;
+
+  for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+    {
+      struct channel *c = &channels[chan_no];
+      if (c->transfer_cnt > 0)
+        printf ("%s: %llu transfers, %llu overlapped with another channel\n",
+                c->name, c->transfer_cnt, c->overlap_cnt);
+    }
+}
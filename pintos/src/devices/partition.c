@@ -181,7 +181,9 @@ found_partition (struct block *block, uint8_t part_type,
       snprintf (name, sizeof name, "%s%d", block_name (block), part_nr);
       snprintf (extra_info, sizeof extra_info, "%s (%02x)",
                 partition_type_name (part_type), part_type);
-      block_register (name, type, extra_info, size, &partition_operations, p);
+      block_set_parent (block_register (name, type, extra_info, size,
+                                        &partition_operations, p),
+                        block);
     }
 }
 
@@ -317,8 +319,43 @@ partition_write (void *p_, block_sector_t sector, const void *buffer)
   block_write (p->block, p->start + sector, buffer);
 }
 
+/* Reads CNT sectors starting at SECTOR from partition P into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+partition_read_multiple (void *p_, block_sector_t sector, size_t cnt,
+                         void *buffer)
+{
+  struct partition *p = p_;
+  block_read_multiple (p->block, p->start + sector, cnt, buffer);
+}
+
+/* Writes CNT sectors starting at SECTOR to partition P from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block has acknowledged receiving the data. */
+static void
+partition_write_multiple (void *p_, block_sector_t sector, size_t cnt,
+                          const void *buffer)
+{
+  struct partition *p = p_;
+  block_write_multiple (p->block, p->start + sector, cnt, buffer);
+}
+
+/* Submits REQ, a request for partition P, to the device that
+   contains P. */
+static void
+partition_submit (void *p_, struct block_request *req)
+{
+  struct partition *p = p_;
+  req->sector += p->start;
+  block_submit (p->block, req);
+}
+
 static struct block_operations partition_operations =
   {
     partition_read,
-    partition_write
+    partition_write,
+    partition_read_multiple,
+    partition_write_multiple,
+    partition_submit
   };
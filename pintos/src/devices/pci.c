@@ -0,0 +1,77 @@
+#include "devices/pci.h"
+#include <debug.h>
+#include "threads/io.h"
+
+/* Access to PCI configuration space, using configuration
+   mechanism #1.  This is only as much of PCI as drivers need to
+   find their devices; Pintos does not enumerate or configure the
+   bus itself. */
+
+/* Configuration mechanism #1 ports. */
+#define PCI_CONFIG_ADDR 0xcf8   /* Address to access. */
+#define PCI_CONFIG_DATA 0xcfc   /* Data at that address. */
+
+/* Selects register REG of function PD for access through
+   PCI_CONFIG_DATA. */
+static void
+select_config (const struct pci_dev *pd, uint8_t reg)
+{
+  ASSERT (pd->dev < 32 && pd->func < 8);
+
+  outl (PCI_CONFIG_ADDR, (0x80000000u | (pd->bus << 16) | (pd->dev << 11)
+                          | (pd->func << 8) | (reg & 0xfc)));
+}
+
+/* Returns the 32-bit configuration register REG of function PD.
+   REG must be a multiple of 4. */
+uint32_t
+pci_read_config (const struct pci_dev *pd, uint8_t reg)
+{
+  select_config (pd, reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Sets the 32-bit configuration register REG of function PD to
+   VALUE.  REG must be a multiple of 4. */
+void
+pci_write_config (const struct pci_dev *pd, uint8_t reg, uint32_t value)
+{
+  select_config (pd, reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Searches the PCI bus for the first function of the given CLASS
+   and SUBCLASS.  If one is found, stores its location in *PD and
+   returns true.  Otherwise, returns false. */
+bool
+pci_find_class (uint8_t class, uint8_t subclass, struct pci_dev *pd)
+{
+  int bus, dev, func;
+
+  for (bus = 0; bus < 256; bus++)
+    for (dev = 0; dev < 32; dev++)
+      for (func = 0; func < 8; func++)
+        {
+          uint32_t cls;
+
+          pd->bus = bus;
+          pd->dev = dev;
+          pd->func = func;
+          if ((pci_read_config (pd, PCI_REG_ID) & 0xffff) == 0xffff)
+            {
+              if (func == 0)
+                break;
+              continue;
+            }
+
+          cls = pci_read_config (pd, PCI_REG_CLASS);
+          if ((cls >> 24) == class && ((cls >> 16) & 0xff) == subclass)
+            return true;
+
+          /* Only multi-function devices have functions past 0. */
+          if (func == 0
+              && !(pci_read_config (pd, PCI_REG_HEADER) & 0x00800000))
+            break;
+        }
+  return false;
+}
@@ -0,0 +1,30 @@
+#ifndef DEVICES_PCI_H
+#define DEVICES_PCI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Location of a PCI function. */
+struct pci_dev
+  {
+    uint8_t bus;                /* Bus number. */
+    uint8_t dev;                /* Device number on bus. */
+    uint8_t func;               /* Function number within device. */
+  };
+
+/* Configuration space registers. */
+#define PCI_REG_ID 0x00         /* Vendor ID (low), device ID (high). */
+#define PCI_REG_COMMAND 0x04    /* Command (low), status (high). */
+#define PCI_REG_CLASS 0x08      /* Class, subclass, prog IF, revision. */
+#define PCI_REG_HEADER 0x0c     /* Header type in bits 16...23. */
+#define PCI_REG_BAR0 0x10       /* First base address register. */
+
+/* Command register bits. */
+#define PCI_CMD_IO 0x0001       /* Respond to I/O space accesses. */
+#define PCI_CMD_MASTER 0x0004   /* Allow bus mastering. */
+
+uint32_t pci_read_config (const struct pci_dev *, uint8_t reg);
+void pci_write_config (const struct pci_dev *, uint8_t reg, uint32_t);
+bool pci_find_class (uint8_t class, uint8_t subclass, struct pci_dev *);
+
+#endif /* devices/pci.h */
@@ -0,0 +1,186 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* RAM disks.
+
+   A RAM disk is a block device whose sectors are kept in pages
+   from the kernel pool, so that reads and writes are just
+   memory copies.  It is useful for measuring the file system
+   and virtual memory layers without the cost of an emulated
+   disk, and as fast swap.
+
+   Each "-ramdisk=ROLE:KB" option on the kernel command line
+   creates a zero-filled RAM disk of KB kilobytes of the given
+   ROLE ("filesys", "scratch", or "swap").  RAM disks are
+   registered before any disk is probed, so each is chosen for
+   its role unless another device is named explicitly.  A file
+   system on a RAM disk must be formatted with -f, and it does
+   not survive rebooting. */
+
+/* Maximum number of RAM disks. */
+#define RAMDISK_MAX 4
+
+/* Sectors per page of storage. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    enum block_type type;               /* Role. */
+    block_sector_t size;                /* Size in sectors. */
+    uint8_t **pages;                    /* Storage, one page at a time. */
+  };
+
+static struct ramdisk ramdisks[RAMDISK_MAX];
+static size_t ramdisk_cnt;
+
+static struct block_operations ramdisk_operations;
+
+/* Configures a RAM disk as given by SPEC, which has the form
+   ROLE:KB, to be created by ramdisk_init().  Panics if SPEC is
+   malformed. */
+void
+ramdisk_configure (const char *spec)
+{
+  static const enum block_type roles[] =
+    {BLOCK_FILESYS, BLOCK_SCRATCH, BLOCK_SWAP};
+  struct ramdisk *rd;
+  const char *colon;
+  size_t i;
+  int kb;
+
+  if (spec == NULL || (colon = strchr (spec, ':')) == NULL)
+    PANIC ("-ramdisk requires ROLE:KB (use -h for help)");
+  if (ramdisk_cnt >= RAMDISK_MAX)
+    PANIC ("too many RAM disks (at most %d)", RAMDISK_MAX);
+  rd = &ramdisks[ramdisk_cnt];
+
+  for (i = 0; i < sizeof roles / sizeof *roles; i++)
+    {
+      const char *name = block_type_name (roles[i]);
+      if (strlen (name) == (size_t) (colon - spec)
+          && !memcmp (name, spec, colon - spec))
+        break;
+    }
+  if (i >= sizeof roles / sizeof *roles)
+    PANIC ("unknown RAM disk role in `%s'", spec);
+
+  kb = atoi (colon + 1);
+  if (kb <= 0)
+    PANIC ("bad RAM disk size in `%s'", spec);
+
+  rd->type = roles[i];
+  rd->size = kb * (1024 / BLOCK_SECTOR_SIZE);
+  ramdisk_cnt++;
+}
+
+/* Creates and registers the RAM disks configured with
+   ramdisk_configure(). */
+void
+ramdisk_init (void)
+{
+  size_t i;
+
+  for (i = 0; i < ramdisk_cnt; i++)
+    {
+      struct ramdisk *rd = &ramdisks[i];
+      size_t page_cnt = DIV_ROUND_UP (rd->size, SECTORS_PER_PAGE);
+      char name[16];
+      size_t j;
+
+      rd->pages = malloc (page_cnt * sizeof *rd->pages);
+      if (rd->pages == NULL)
+        PANIC ("Failed to allocate memory for RAM disk page table");
+      for (j = 0; j < page_cnt; j++)
+        {
+          rd->pages[j] = palloc_get_page (PAL_ZERO);
+          if (rd->pages[j] == NULL)
+            PANIC ("Out of kernel memory for RAM disk (try a smaller "
+                   "size, or -ul to shrink the user pool)");
+        }
+
+      snprintf (name, sizeof name, "rd%zu", i);
+      block_register (name, rd->type, "RAM disk", rd->size,
+                      &ramdisk_operations, rd);
+    }
+}
+
+/* Returns the address of SECTOR within RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads CNT sectors starting at SECTOR from RAM disk RD into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+ramdisk_read_multiple (void *rd_, block_sector_t sector, size_t cnt,
+                       void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *buffer = buffer_;
+
+  for (; cnt > 0; sector++, cnt--, buffer += BLOCK_SECTOR_SIZE)
+    memcpy (buffer, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes CNT sectors starting at SECTOR to RAM disk RD from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write_multiple (void *rd_, block_sector_t sector, size_t cnt,
+                        const void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  const uint8_t *buffer = buffer_;
+
+  for (; cnt > 0; sector++, cnt--, buffer += BLOCK_SECTOR_SIZE)
+    memcpy (sector_addr (rd, sector), buffer, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER, which must
+   have room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  ramdisk_read_multiple (rd, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER, which must
+   contain BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  ramdisk_write_multiple (rd, sector, 1, buffer);
+}
+
+/* Carries out REQ on RAM disk RD at once.  There is nothing to
+   gain from queuing and scheduling requests to memory. */
+static void
+ramdisk_submit (void *rd, struct block_request *req)
+{
+  if (req->write)
+    ramdisk_write_multiple (rd, req->sector, req->cnt, req->buffer);
+  else
+    ramdisk_read_multiple (rd, req->sector, req->cnt, req->buffer);
+  block_complete (req);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    ramdisk_write_multiple,
+    ramdisk_submit
+  };
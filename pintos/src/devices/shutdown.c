@@ -9,8 +9,12 @@
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
+#ifdef VM
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "devices/ide.h"
 #include "filesys/filesys.h"
 #endif
 
@@ -123,6 +127,10 @@ print_stats (void)
   thread_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  ide_print_stats ();
+#endif
+#ifdef VM
+  vm_swap_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
@@ -1,6 +1,7 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
@@ -17,18 +18,71 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* PIT cycles per timer tick. */
+#define TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Most timer ticks that one PIT period can span. */
+#define MAX_PERIOD_TICKS (65536 / TICK_COUNT)
+
+/* Tickless idle.
+
+   Normally the PIT interrupts once per timer tick.  When the
+   idle thread is about to halt the CPU, timer_idle_enter()
+   stretches the PIT's current period to end when the first
+   sleeping thread wakes up, or as far as the 16-bit PIT counter
+   allows, so that an idle CPU is not woken just to count ticks.
+   The interrupt at the end of a long period counts all of the
+   ticks in it.  If some other interrupt makes a thread ready
+   before then, timer_idle_exit() counts the ticks that have
+   passed so far and puts the PIT back on the tick boundaries.
+
+   While idle, the first wakeup may also be delayed by up to
+   timer_slack ticks, so that wakeups close together share one
+   interrupt. */
+
+/* Number of timer ticks since OS booted, not counting those
+   that have passed in the PIT's current period. */
 static int64_t ticks;
 
+/* The PIT's current period. */
+static unsigned period_count = TICK_COUNT;  /* Length in PIT cycles. */
+static int period_ticks = 1;                /* Ticks done at its end. */
+
+/* Ticks by which a wakeup may be delayed while idle. */
+static int64_t timer_slack;
+
+/* Number of timer interrupts since OS booted. */
+static int64_t interrupt_cnt;
+
+/* Timer ticks over which to count TSC cycles. */
+#define TSC_CALIBRATE_TICKS (TIMER_FREQ / 10)
+
+/* Nanosecond clock based on the CPU's time-stamp counter (TSC).
+   Initialized by timer_calibrate(). */
+static uint64_t tsc_hz;         /* TSC cycles per second, 0 if unknown. */
+static uint64_t tsc_base;       /* TSC at... */
+static int64_t ns_base;         /* ...this many nanoseconds after boot. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Threads blocked in timer_sleep(), in order of wakeup_tick.
+   Threads with the same wakeup_tick are in the order they went
+   to sleep. */
+static struct list sleep_list = LIST_INITIALIZER (sleep_list);
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static void wake_sleepers (void);
+static void set_period (unsigned count, int tick_cnt);
+static inline uint64_t rdtsc (void);
+static int ticks_into_period (void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
@@ -39,11 +93,13 @@ timer_init (void)
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and the rate of the TSC, used by timer_ns(). */
 void
 timer_calibrate (void) 
 {
   unsigned high_bit, test_bit;
+  int64_t start;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
@@ -63,7 +119,29 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  /* Count TSC cycles from one tick to a later one. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  start = ticks;
+  tsc_base = rdtsc ();
+  while (ticks - start < TSC_CALIBRATE_TICKS)
+    barrier ();
+  tsc_hz = (rdtsc () - tsc_base) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+  ns_base = start * (1000000000 / TIMER_FREQ);
+
+  printf ("%'"PRIu64" loops/s, %'"PRIu64" TSC cycles/s.\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, tsc_hz);
+}
+
+/* Allows a sleeping thread's wakeup to be delayed by up to TICKS
+   timer ticks while the CPU is idle, so that it can share a
+   timer interrupt with later wakeups. */
+void
+timer_set_slack (int64_t ticks)
+{
+  ASSERT (ticks >= 0);
+  timer_slack = ticks;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -71,7 +149,7 @@ int64_t
 timer_ticks (void) 
 {
   enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
+  int64_t t = ticks + ticks_into_period ();
   intr_set_level (old_level);
   return t;
 }
@@ -84,16 +162,45 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted, to the
+   resolution of the TSC.  Before timer_calibrate() has been
+   called, this is only as fine as timer ticks.  May be called
+   with interrupts on or off, including from an interrupt
+   handler. */
+int64_t
+timer_ns (void)
+{
+  uint64_t cycles;
+
+  if (tsc_hz == 0)
+    return timer_ticks () * (1000000000 / TIMER_FREQ);
+
+  /* Convert whole seconds and the remainder separately, so that
+     the multiplication cannot overflow. */
+  cycles = rdtsc () - tsc_base;
+  return (ns_base + cycles / tsc_hz * 1000000000
+          + cycles % tsc_hz * 1000000000 / tsc_hz);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.  The thread is blocked, not just yielding, until
+   the timer interrupt handler wakes it up, so that it uses no CPU
+   time meanwhile. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  t->wakeup_tick = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &t->elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -159,19 +266,165 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  Stretches the PIT's current period to end
+   when the first sleeping thread is due to wake up. */
+void
+timer_idle_enter (void)
+{
+  int64_t wakeup;
+  unsigned left;
+  int64_t cnt;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* If a tick is pending, let it be counted first. */
+  if (period_ticks != 1 || intr_is_pending (0x20))
+    return;
+
+  if (list_empty (&sleep_list))
+    wakeup = ticks + MAX_PERIOD_TICKS;
+  else
+    {
+      struct list_elem *e;
+      int64_t first_wakeup;
+
+      /* Wake at the last wakeup within timer_slack ticks of the
+         first, so that no sleeper is delayed more than that. */
+      first_wakeup = list_entry (list_front (&sleep_list),
+                                 struct thread, elem)->wakeup_tick;
+      wakeup = first_wakeup;
+      for (e = list_next (list_front (&sleep_list));
+           e != list_end (&sleep_list); e = list_next (e))
+        {
+          struct thread *t = list_entry (e, struct thread, elem);
+          if (t->wakeup_tick > first_wakeup + timer_slack)
+            break;
+          wakeup = t->wakeup_tick;
+        }
+    }
+
+  /* The period already has LEFT cycles to go before the next
+     tick.  Extend it by whole ticks. */
+  left = pit_read_count (0);
+  cnt = wakeup - ticks;
+  if (cnt > 1 + (65536 - left) / TICK_COUNT)
+    cnt = 1 + (65536 - left) / TICK_COUNT;
+  if (cnt > 1)
+    set_period (left + (cnt - 1) * TICK_COUNT, cnt);
+}
+
+/* Called by the idle thread, with interrupts off, when it stops
+   idling.  If the PIT is in a long period, counts the ticks that
+   have passed in it and ends the period at the next tick. */
+void
+timer_idle_exit (void)
+{
+  unsigned left;
+  int passed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* If the long period has already ended, its interrupt will
+     count it. */
+  if (period_ticks == 1 || intr_is_pending (0x20))
+    return;
+
+  left = pit_read_count (0);
+  passed = period_ticks - DIV_ROUND_UP (left, TICK_COUNT);
+  ticks += passed;
+  thread_tick_idle (passed);
+
+  /* Cycles to go before the next tick.  A count of 1 is not
+     allowed. */
+  left = (left - 1) % TICK_COUNT + 1;
+  set_period (left > 1 ? left : 2, 1);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
 {
-  printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  printf ("Timer: %"PRId64" ticks, %"PRId64" interrupts\n",
+          timer_ticks (), interrupt_cnt);
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick ();
+  int i;
+
+  ticks += period_ticks;
+  interrupt_cnt++;
+  wake_sleepers ();
+  for (i = 0; i < period_ticks; i++)
+    thread_tick ();
+
+  /* After a long period, or the short one that ends an early
+     exit from idle, go back to ticking. */
+  if (period_count != TICK_COUNT)
+    set_period (TICK_COUNT, 1);
+}
+
+/* Returns true if thread A should wake up before thread B. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
+/* Wakes up the sleeping threads whose time has come.  Called
+   from the timer interrupt handler. */
+static void
+wake_sleepers (void)
+{
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+}
+
+/* Starts a new PIT period of COUNT cycles, at the end of which
+   TICK_CNT timer ticks will have passed. */
+static void
+set_period (unsigned count, int tick_cnt)
+{
+  pit_configure_count (0, 2, count);
+  period_count = count;
+  period_ticks = tick_cnt;
+}
+
+/* Returns the CPU's time-stamp counter, which counts clock
+   cycles at a constant rate. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the number of timer ticks that have passed in the
+   PIT's current period.  Interrupts must be off. */
+static int
+ticks_into_period (void)
+{
+  if (period_ticks == 1)
+    return 0;
+  else if (intr_is_pending (0x20))
+    return period_ticks;
+  else
+    return period_ticks - DIV_ROUND_UP (pit_read_count (0), TICK_COUNT);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -0,0 +1,70 @@
+/* fsbench-conc.c
+
+   Measures aggregate read throughput with several processes
+   reading the same file at once.
+
+   usage: fsbench-conc [READERS [KB]]
+   starts READERS child processes (default 4) that each read
+   a KB-kilobyte file (default 256) from start to end. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "fsbench.h"
+
+static char buf[4096];
+
+/* Reads all of bench.dat, as a child process. */
+static int
+reader (void)
+{
+  int fd = open ("bench.dat");
+  int n;
+
+  if (fd < 0)
+    return EXIT_FAILURE;
+  while ((n = read (fd, buf, sizeof buf)) > 0)
+    continue;
+  close (fd);
+  return n == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int readers, kb;
+  pid_t children[16];
+  struct bench b;
+  int i;
+
+  if (argc > 1 && !strcmp (argv[1], "-r"))
+    return reader ();
+
+  readers = argc > 1 ? atoi (argv[1]) : 4;
+  kb = argc > 2 ? atoi (argv[2]) : 256;
+  if (readers > (int) (sizeof children / sizeof *children))
+    readers = sizeof children / sizeof *children;
+  close (bench_create ("bench.dat", kb * 1024));
+
+  bench_start (&b, "concurrent read");
+  for (i = 0; i < readers; i++)
+    {
+      children[i] = exec ("fsbench-conc -r");
+      if (children[i] == PID_ERROR)
+        {
+          printf ("exec failed\n");
+          return EXIT_FAILURE;
+        }
+    }
+  for (i = 0; i < readers; i++)
+    if (wait (children[i]) != EXIT_SUCCESS)
+      {
+        printf ("reader %d failed\n", i);
+        return EXIT_FAILURE;
+      }
+  bench_end (&b, (unsigned long long) readers * kb * 1024, "bytes");
+  remove ("bench.dat");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+/* fsbench-files.c
+
+   Measures how fast small files can be created and deleted.
+
+   usage: fsbench-files [COUNT [BYTES]]
+   creates COUNT files (default 64) of BYTES bytes each (default
+   100), then deletes them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "fsbench.h"
+
+static char buf[4096];
+
+int
+main (int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi (argv[1]) : 64;
+  unsigned bytes = argc > 2 ? atoi (argv[2]) : 100;
+  struct bench b;
+  int i;
+
+  if (bytes > sizeof buf)
+    bytes = sizeof buf;
+  bench_fill (buf, bytes, 0);
+
+  bench_start (&b, "create");
+  for (i = 0; i < count; i++)
+    {
+      char name[16];
+      int fd;
+
+      snprintf (name, sizeof name, "f%d", i);
+      if (!create (name, 0) || (fd = open (name)) < 0)
+        {
+          printf ("%s: create failed\n", name);
+          return EXIT_FAILURE;
+        }
+      write (fd, buf, bytes);
+      close (fd);
+    }
+  bench_end (&b, count, "files");
+
+  bench_start (&b, "delete");
+  for (i = 0; i < count; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "f%d", i);
+      if (!remove (name))
+        {
+          printf ("%s: remove failed\n", name);
+          return EXIT_FAILURE;
+        }
+    }
+  bench_end (&b, count, "files");
+
+  return EXIT_SUCCESS;
+}
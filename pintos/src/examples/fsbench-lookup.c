@@ -0,0 +1,72 @@
+/* fsbench-lookup.c
+
+   Measures how fast files can be opened by name in a large
+   directory.
+
+   usage: fsbench-lookup [COUNT [OPS]]
+   creates COUNT empty files (default 128), then opens and closes
+   OPS of them (default 1024) chosen at random, then removes
+   them. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "fsbench.h"
+
+int
+main (int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi (argv[1]) : 128;
+  int ops = argc > 2 ? atoi (argv[2]) : 1024;
+  char name[16];
+  struct bench b;
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      snprintf (name, sizeof name, "l%d", i);
+      if (!create (name, 0))
+        {
+          printf ("%s: create failed\n", name);
+          return EXIT_FAILURE;
+        }
+    }
+
+  random_init (0);
+  bench_start (&b, "lookup");
+  for (i = 0; i < ops; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "l%lu", random_ulong () % count);
+      fd = open (name);
+      if (fd < 0)
+        {
+          printf ("%s: open failed\n", name);
+          return EXIT_FAILURE;
+        }
+      close (fd);
+    }
+  bench_end (&b, ops, "opens");
+
+  bench_start (&b, "missing");
+  for (i = 0; i < ops; i++)
+    {
+      snprintf (name, sizeof name, "m%lu", random_ulong () % count);
+      if (open (name) >= 0)
+        {
+          printf ("%s: open succeeded\n", name);
+          return EXIT_FAILURE;
+        }
+    }
+  bench_end (&b, ops, "opens");
+
+  for (i = 0; i < count; i++)
+    {
+      snprintf (name, sizeof name, "l%d", i);
+      remove (name);
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+/* fsbench-rand.c
+
+   Measures random read and write throughput, using pread() and
+   pwrite() at block-aligned offsets, for a range of request
+   sizes.
+
+   usage: fsbench-rand [KB [OPS]]
+   where KB is the size of the test file (default 512) and OPS is
+   the number of requests per phase (default 256). */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "fsbench.h"
+
+static char buf[16384];
+
+int
+main (int argc, char *argv[])
+{
+  static const unsigned block_sizes[] = {512, 4096, 16384};
+  unsigned size = (argc > 1 ? atoi (argv[1]) : 512) * 1024;
+  unsigned ops = argc > 2 ? atoi (argv[2]) : 256;
+  size_t i;
+  int fd;
+
+  fd = bench_create ("bench.dat", size);
+  random_init (0);
+  for (i = 0; i < sizeof block_sizes / sizeof *block_sizes; i++)
+    {
+      unsigned block_size = block_sizes[i];
+      unsigned blocks = size / block_size;
+      char name[64];
+      struct bench b;
+      unsigned j;
+
+      snprintf (name, sizeof name, "rand-read %u", block_size);
+      bench_start (&b, name);
+      for (j = 0; j < ops; j++)
+        {
+          unsigned ofs = random_ulong () % blocks * block_size;
+          if (pread (fd, buf, block_size, ofs) != (int) block_size)
+            {
+              printf ("bench.dat: read failed\n");
+              return EXIT_FAILURE;
+            }
+        }
+      bench_end (&b, ops, "ops");
+
+      snprintf (name, sizeof name, "rand-write %u", block_size);
+      bench_start (&b, name);
+      for (j = 0; j < ops; j++)
+        {
+          unsigned ofs = random_ulong () % blocks * block_size;
+          if (pwrite (fd, buf, block_size, ofs) != (int) block_size)
+            {
+              printf ("bench.dat: write failed\n");
+              return EXIT_FAILURE;
+            }
+        }
+      bench_end (&b, ops, "ops");
+    }
+  close (fd);
+  remove ("bench.dat");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/* fsbench-seq.c
+
+   Measures sequential write and read throughput for a range of
+   request sizes.
+
+   usage: fsbench-seq [KB]
+   where KB is the size of the test file (default 512). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "fsbench.h"
+
+static char buf[65536];
+
+int
+main (int argc, char *argv[])
+{
+  static const unsigned block_sizes[] = {512, 4096, 16384, 65536};
+  unsigned size = (argc > 1 ? atoi (argv[1]) : 512) * 1024;
+  size_t i;
+
+  bench_fill (buf, sizeof buf, 0);
+  for (i = 0; i < sizeof block_sizes / sizeof *block_sizes; i++)
+    {
+      unsigned block_size = block_sizes[i];
+      char name[64];
+      struct bench b;
+      unsigned ofs;
+      int fd;
+
+      remove ("bench.dat");
+      if (!create ("bench.dat", 0) || (fd = open ("bench.dat")) < 0)
+        {
+          printf ("bench.dat: create failed\n");
+          return EXIT_FAILURE;
+        }
+
+      snprintf (name, sizeof name, "seq-write %u", block_size);
+      bench_start (&b, name);
+      for (ofs = 0; ofs < size; ofs += block_size)
+        if (write (fd, buf, block_size) != (int) block_size)
+          {
+            printf ("bench.dat: write failed\n");
+            return EXIT_FAILURE;
+          }
+      close (fd);
+      bench_end (&b, size, "bytes");
+
+      fd = open ("bench.dat");
+      snprintf (name, sizeof name, "seq-read %u", block_size);
+      bench_start (&b, name);
+      for (ofs = 0; ofs < size; ofs += block_size)
+        if (read (fd, buf, block_size) != (int) block_size)
+          {
+            printf ("bench.dat: read failed\n");
+            return EXIT_FAILURE;
+          }
+      bench_end (&b, size, "bytes");
+      close (fd);
+    }
+  remove ("bench.dat");
+
+  return EXIT_SUCCESS;
+}
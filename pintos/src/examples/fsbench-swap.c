@@ -0,0 +1,139 @@
+/* fsbench-swap.c
+
+   Measures how well swap and file system I/O overlap.  Runs a
+   process that pages through more memory than fits in the user
+   pool, a process that writes and reads back a file, and then
+   both at once.  If the swap and file system devices are on
+   different IDE channels, e.g. hda and hdc, the two should
+   take noticeably less time together than the sum of their
+   times alone; the kernel's "overlapped" channel statistics at
+   power-off show the same thing from the disk's side.
+
+   usage: fsbench-swap [PASSES [KB]]
+   where PASSES is the number of times the memory process
+   writes every page of its 2 MB array (default 4) and KB is
+   the size of the file process's file (default 512).  Limit the
+   user pool to force paging, e.g.:
+
+     pintos -v -k -T 600 --qemu --filesys-size=8 --swap-size=4 \
+       -p fsbench-swap -a fsbench-swap -- -q -f -ul=128 \
+       run 'fsbench-swap 4 512'
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "fsbench.h"
+
+#define MEM_SIZE (2 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+static char mem[MEM_SIZE];
+static char buf[4096];
+
+/* Writes every page of MEM PASSES times, checking the previous
+   pass's data each time, as a child process. */
+static int
+memory_worker (int passes)
+{
+  int pass;
+  size_t ofs;
+
+  for (pass = 0; pass < passes; pass++)
+    for (ofs = 0; ofs < MEM_SIZE; ofs += PAGE_SIZE)
+      {
+        if (mem[ofs] != (char) (pass + ofs / PAGE_SIZE))
+          return EXIT_FAILURE;
+        mem[ofs] = pass + 1 + ofs / PAGE_SIZE;
+      }
+  return EXIT_SUCCESS;
+}
+
+/* Writes a KB-kilobyte file and reads it back, as a child
+   process. */
+static int
+file_worker (int kb)
+{
+  int fd = bench_create ("swap.dat", kb * 1024);
+  int n;
+
+  while ((n = read (fd, buf, sizeof buf)) > 0)
+    continue;
+  close (fd);
+  remove ("swap.dat");
+  return n == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Starts a child process running this program with ARGS. */
+static pid_t
+start (const char *args)
+{
+  char cmd_line[64];
+  pid_t pid;
+
+  snprintf (cmd_line, sizeof cmd_line, "fsbench-swap %s", args);
+  pid = exec (cmd_line);
+  if (pid == PID_ERROR)
+    {
+      printf ("exec failed\n");
+      exit (EXIT_FAILURE);
+    }
+  return pid;
+}
+
+/* Waits for child process PID, exiting if it failed. */
+static void
+finish (pid_t pid)
+{
+  if (wait (pid) != EXIT_SUCCESS)
+    {
+      printf ("child %d failed\n", pid);
+      exit (EXIT_FAILURE);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  char mem_args[16], file_args[16];
+  long long mem_ns, file_ns, both_ns;
+  int passes, kb;
+  struct bench b;
+  pid_t mem_pid, file_pid;
+
+  if (argc > 2 && !strcmp (argv[1], "-m"))
+    return memory_worker (atoi (argv[2]));
+  if (argc > 2 && !strcmp (argv[1], "-f"))
+    return file_worker (atoi (argv[2]));
+
+  passes = argc > 1 ? atoi (argv[1]) : 4;
+  kb = argc > 2 ? atoi (argv[2]) : 512;
+  snprintf (mem_args, sizeof mem_args, "-m %d", passes);
+  snprintf (file_args, sizeof file_args, "-f %d", kb);
+
+  bench_start (&b, "swap alone");
+  finish (start (mem_args));
+  bench_end (&b, (unsigned long long) passes * MEM_SIZE, "bytes");
+  mem_ns = clock_ns () - b.start;
+
+  bench_start (&b, "files alone");
+  finish (start (file_args));
+  bench_end (&b, (unsigned long long) kb * 1024, "bytes");
+  file_ns = clock_ns () - b.start;
+
+  bench_start (&b, "swap and files together");
+  mem_pid = start (mem_args);
+  file_pid = start (file_args);
+  finish (mem_pid);
+  finish (file_pid);
+  bench_end (&b, (unsigned long long) passes * MEM_SIZE + kb * 1024,
+             "bytes");
+  both_ns = clock_ns () - b.start;
+
+  if (mem_ns + file_ns > 0)
+    printf ("together took %lld%% of the time of the two alone\n",
+            both_ns * 100 / (mem_ns + file_ns));
+
+  return EXIT_SUCCESS;
+}
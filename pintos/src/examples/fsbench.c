@@ -0,0 +1,77 @@
+/* fsbench.c
+
+   Helpers shared by the fsbench-* file system benchmarks. */
+
+#include "fsbench.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Starts timing the phase called NAME. */
+void
+bench_start (struct bench *b, const char *name)
+{
+  b->name = name;
+  block_stats ("filesys", &b->stats);
+  b->start = clock_ns ();
+}
+
+/* Stops timing B, which did AMOUNT units of work, and prints the
+   results. */
+void
+bench_end (struct bench *b, unsigned long long amount, const char *unit)
+{
+  unsigned long long elapsed = (clock_ns () - b->start) / 1000;
+  struct block_stats stats;
+
+  block_stats ("filesys", &stats);
+  printf ("%s: %llu %s in %llu us", b->name, amount, unit, elapsed);
+  if (elapsed > 0)
+    printf (" (%llu %s/s)", amount * 1000000 / elapsed, unit);
+  printf (", %llu sectors read, %llu written",
+          stats.read_cnt - b->stats.read_cnt,
+          stats.write_cnt - b->stats.write_cnt);
+  printf (", %llu requests in %llu us of service\n",
+          stats.request_cnt - b->stats.request_cnt,
+          (stats.service_ns - b->stats.service_ns) / 1000);
+}
+
+/* Fills the SIZE bytes in BUF with data that depends on SEED. */
+void
+bench_fill (void *buf_, size_t size, unsigned seed)
+{
+  unsigned char *buf = buf_;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    buf[i] = seed + i * 7;
+}
+
+/* Creates file NAME, writes SIZE bytes of data to it, and
+   returns a file descriptor for it positioned at the start.
+   Exits on failure. */
+int
+bench_create (const char *name, unsigned size)
+{
+  static char buf[4096];
+  unsigned ofs;
+  int fd;
+
+  remove (name);
+  if (!create (name, 0) || (fd = open (name)) < 0)
+    {
+      printf ("%s: create failed\n", name);
+      exit (EXIT_FAILURE);
+    }
+  for (ofs = 0; ofs < size; ofs += sizeof buf)
+    {
+      unsigned chunk = size - ofs < sizeof buf ? size - ofs : sizeof buf;
+      bench_fill (buf, chunk, ofs);
+      if (write (fd, buf, chunk) != (int) chunk)
+        {
+          printf ("%s: write failed\n", name);
+          exit (EXIT_FAILURE);
+        }
+    }
+  seek (fd, 0);
+  return fd;
+}
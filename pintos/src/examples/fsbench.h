@@ -0,0 +1,32 @@
+#ifndef EXAMPLES_FSBENCH_H
+#define EXAMPLES_FSBENCH_H
+
+/* Helpers shared by the fsbench-* file system benchmarks.
+
+   Each benchmark times one phase of work with bench_start() and
+   bench_end(), which prints how much was done per second,
+   how many sectors the file system device read and wrote during
+   the phase, and how long the device took to service them.  The
+   benchmarks run headless, e.g.:
+
+     pintos -v -k -T 600 --qemu --filesys-size=8 -p fsbench-seq \
+       -a fsbench-seq -- -q -f run 'fsbench-seq 512'
+*/
+
+#include <stddef.h>
+#include <syscall.h>
+
+/* A phase being timed. */
+struct bench
+  {
+    const char *name;                   /* Printed with results. */
+    long long start;                    /* clock_ns() at start. */
+    struct block_stats stats;           /* Device statistics at start. */
+  };
+
+void bench_start (struct bench *, const char *name);
+void bench_end (struct bench *, unsigned long long amount, const char *unit);
+void bench_fill (void *, size_t size, unsigned seed);
+int bench_create (const char *name, unsigned size);
+
+#endif /* examples/fsbench.h */
@@ -0,0 +1,381 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+
+/* Buffer cache.
+
+   Holds recently used sectors of the file system device in
+   memory.  All reads and writes of fs_device go through here, so
+   partial-sector accesses are done by copying into or out of a
+   cached sector instead of a temporary buffer.  Writes are
+   write-behind: a dirty sector is written to disk only when it is
+   evicted or when cache_flush() is called.
+
+   Entries are replaced in "clock" order.  An entry that is in
+   use by some thread is "pinned" and is never chosen for
+   replacement.  The log also pins sectors, with
+   cache_write_pinned(), to keep them from being written to disk
+   before they are committed. */
+
+/* Number of sectors in the cache. */
+#define CACHE_SIZE 64
+
+/* A cached sector. */
+struct cache_entry
+  {
+    /* Protected by cache_lock. */
+    block_sector_t sector;              /* Sector held, if in_use. */
+    bool in_use;                        /* Holds a sector or free? */
+    bool accessed;                      /* Recently used? */
+    int pin_cnt;                        /* Number of threads using entry. */
+    bool writing_back;                  /* Writing back old_sector? */
+    block_sector_t old_sector;          /* Sector being written back. */
+
+    /* Protected by rwlock. */
+    struct rwlock rwlock;               /* Shared to read, exclusive to
+                                           write or load DATA. */
+    bool dirty;                         /* Modified since read from disk? */
+    struct block_request request;       /* For writing back DATA. */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Sector contents. */
+  };
+
+static struct cache_entry entries[CACHE_SIZE];
+
+/* Next entry to consider for replacement. */
+static size_t clock_hand;
+
+/* Protects the members of each entry noted above, and
+   clock_hand. */
+static struct lock cache_lock;
+
+/* Signaled when an entry is unpinned or finishes writing back. */
+static struct condition cache_changed;
+
+static struct cache_entry *cache_get (block_sector_t, bool write, bool load);
+static void cache_put (struct cache_entry *, bool write);
+static struct cache_entry *find (block_sector_t);
+static bool writing_back (block_sector_t);
+static struct cache_entry *choose_victim (void);
+
+/* Initializes the buffer cache. */
+void
+cache_init (void)
+{
+  size_t i;
+
+  lock_init (&cache_lock);
+  cond_init (&cache_changed);
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &entries[i];
+      e->in_use = false;
+      e->accessed = false;
+      e->pin_cnt = 0;
+      e->writing_back = false;
+      rwlock_init (&e->rwlock);
+      e->dirty = false;
+    }
+  clock_hand = 0;
+}
+
+/* Reads SIZE bytes starting at byte OFS within SECTOR into
+   BUFFER. */
+void
+cache_read (block_sector_t sector, void *buffer, int ofs, int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, false, true);
+  memcpy (buffer, e->data + ofs, size);
+  cache_put (e, false);
+}
+
+/* Writes SIZE bytes from BUFFER into SECTOR starting at byte
+   OFS.  If the whole sector is overwritten, its old contents are
+   not read from disk. */
+void
+cache_write (block_sector_t sector, const void *buffer, int ofs, int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, true, ofs != 0 || size != BLOCK_SECTOR_SIZE);
+  memcpy (e->data + ofs, buffer, size);
+  e->dirty = true;
+  cache_put (e, true);
+}
+
+/* Writes every dirty sector in the cache to disk.  All of the
+   writes are submitted before waiting for any of them, so that
+   the disk always has the next one queued. */
+void
+cache_flush (void)
+{
+  bool submitted[CACHE_SIZE];
+  size_t i;
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &entries[i];
+
+      submitted[i] = false;
+      lock_acquire (&cache_lock);
+      if (!e->in_use)
+        {
+          lock_release (&cache_lock);
+          continue;
+        }
+      e->pin_cnt++;
+      lock_release (&cache_lock);
+
+      rwlock_acquire_write (&e->rwlock);
+      if (e->dirty)
+        {
+          block_request_init (&e->request, true, e->sector, 1, e->data,
+                              NULL, NULL);
+          block_submit (fs_device, &e->request);
+          submitted[i] = true;
+        }
+      else
+        cache_put (e, true);
+    }
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (submitted[i])
+      {
+        struct cache_entry *e = &entries[i];
+
+        block_wait (&e->request);
+        e->dirty = false;
+        cache_put (e, true);
+      }
+}
+
+/* Like cache_write(), but leaves SECTOR pinned, so that it stays
+   cached, and is not written back, until a matching call to
+   cache_unpin().  The entry is pinned before it is modified, so
+   the modified sector cannot reach disk in between. */
+void
+cache_write_pinned (block_sector_t sector, const void *buffer, int ofs,
+                    int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector, true, ofs != 0 || size != BLOCK_SECTOR_SIZE);
+  memcpy (e->data + ofs, buffer, size);
+  e->dirty = true;
+  rwlock_release_write (&e->rwlock);
+}
+
+/* Undoes one call to cache_write_pinned() for SECTOR. */
+void
+cache_unpin (block_sector_t sector)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  e = find (sector);
+  ASSERT (e != NULL);
+  ASSERT (e->pin_cnt > 0);
+  if (--e->pin_cnt == 0)
+    cond_broadcast (&cache_changed, &cache_lock);
+  lock_release (&cache_lock);
+}
+
+/* Makes sure that the latest contents of SECTOR are on disk,
+   writing it back if it is cached and dirty, or waiting for it
+   if it is already on its way. */
+void
+cache_write_back (block_sector_t sector)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  while (writing_back (sector))
+    cond_wait (&cache_changed, &cache_lock);
+  e = find (sector);
+  if (e == NULL)
+    {
+      lock_release (&cache_lock);
+      return;
+    }
+  e->pin_cnt++;
+  lock_release (&cache_lock);
+
+  rwlock_acquire_write (&e->rwlock);
+  if (e->dirty)
+    {
+      block_write (fs_device, e->sector, e->data);
+      e->dirty = false;
+    }
+  cache_put (e, true);
+}
+
+/* Returns the pinned cache entry for SECTOR, locked for writing
+   if WRITE is true or for reading otherwise.  If SECTOR is not
+   already cached, replaces some other sector with it, reading
+   its contents from disk if LOAD is true.  LOAD may be false only
+   if WRITE is true and the caller will overwrite the whole
+   sector.  Release the entry with cache_put(). */
+static struct cache_entry *
+cache_get (block_sector_t sector, bool write, bool load)
+{
+  struct cache_entry *e;
+  block_sector_t old_sector = 0;
+  bool write_back = false;
+
+  ASSERT (load || write);
+
+  lock_acquire (&cache_lock);
+  for (;;)
+    {
+      e = find (sector);
+      if (e != NULL)
+        {
+          /* Cache hit.  If another thread is still loading the
+             sector, locking the entry waits for it to finish. */
+          e->pin_cnt++;
+          e->accessed = true;
+          lock_release (&cache_lock);
+          if (write)
+            rwlock_acquire_write (&e->rwlock);
+          else
+            rwlock_acquire_read (&e->rwlock);
+          return e;
+        }
+
+      /* An old copy of SECTOR may be on its way to disk.  Reading
+         the disk before that finishes would return stale data. */
+      if (!writing_back (sector))
+        {
+          e = choose_victim ();
+          if (e != NULL)
+            break;
+        }
+      cond_wait (&cache_changed, &cache_lock);
+    }
+
+  /* Cache miss.  Claim E for SECTOR and lock it so that threads
+     that find it before it is loaded wait.  E is unpinned, so
+     nobody holds its lock and acquiring it does not sleep. */
+  rwlock_acquire_write (&e->rwlock);
+  if (e->in_use && e->dirty)
+    {
+      write_back = true;
+      old_sector = e->sector;
+      e->writing_back = true;
+      e->old_sector = old_sector;
+    }
+  e->sector = sector;
+  e->in_use = true;
+  e->accessed = true;
+  e->pin_cnt = 1;
+  lock_release (&cache_lock);
+
+  if (write_back)
+    {
+      block_write (fs_device, old_sector, e->data);
+      lock_acquire (&cache_lock);
+      e->writing_back = false;
+      cond_broadcast (&cache_changed, &cache_lock);
+      lock_release (&cache_lock);
+    }
+  if (load)
+    block_read (fs_device, sector, e->data);
+  e->dirty = false;
+
+  if (!write)
+    {
+      /* Another writer may get in between these, but by then the
+         data is valid. */
+      rwlock_release_write (&e->rwlock);
+      rwlock_acquire_read (&e->rwlock);
+    }
+  return e;
+}
+
+/* Unlocks and unpins E, which was obtained from cache_get() with
+   the same WRITE argument. */
+static void
+cache_put (struct cache_entry *e, bool write)
+{
+  if (write)
+    rwlock_release_write (&e->rwlock);
+  else
+    rwlock_release_read (&e->rwlock);
+
+  lock_acquire (&cache_lock);
+  ASSERT (e->pin_cnt > 0);
+  if (--e->pin_cnt == 0)
+    cond_broadcast (&cache_changed, &cache_lock);
+  lock_release (&cache_lock);
+}
+
+/* Returns the entry that holds SECTOR, or a null pointer if
+   SECTOR is not cached.  The caller must hold cache_lock. */
+static struct cache_entry *
+find (block_sector_t sector)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (entries[i].in_use && entries[i].sector == sector)
+      return &entries[i];
+  return NULL;
+}
+
+/* Returns true if an old copy of SECTOR is being written back
+   from an entry that has been reused.  The caller must hold
+   cache_lock. */
+static bool
+writing_back (block_sector_t sector)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (entries[i].writing_back && entries[i].old_sector == sector)
+      return true;
+  return false;
+}
+
+/* Chooses an entry to hold a new sector: a free entry if there
+   is one, otherwise the next unpinned entry in clock order that
+   has not been accessed since the hand last passed it.  Returns
+   a null pointer if every entry is pinned.  The caller must hold
+   cache_lock. */
+static struct cache_entry *
+choose_victim (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (!entries[i].in_use && entries[i].pin_cnt == 0)
+      return &entries[i];
+
+  for (i = 0; i < 2 * CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &entries[clock_hand];
+      clock_hand = (clock_hand + 1) % CACHE_SIZE;
+
+      if (e->pin_cnt > 0 || e->writing_back)
+        continue;
+      if (e->accessed)
+        e->accessed = false;
+      else
+        return e;
+    }
+  return NULL;
+}
@@ -0,0 +1,14 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include "devices/block.h"
+
+void cache_init (void);
+void cache_read (block_sector_t, void *, int ofs, int size);
+void cache_write (block_sector_t, const void *, int ofs, int size);
+void cache_flush (void);
+void cache_write_pinned (block_sector_t, const void *, int ofs, int size);
+void cache_unpin (block_sector_t);
+void cache_write_back (block_sector_t);
+
+#endif /* filesys/cache.h */
@@ -0,0 +1,213 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* Directory entry cache.
+
+   Maps a (parent directory inode sector, name) pair to the
+   sector of the inode that the name refers to, so that repeated
+   lookups of the same path component do not have to scan the
+   parent directory.  Names that are known not to exist are
+   cached too, as "negative" entries.
+
+   The cache has a fixed number of entries, recycled in
+   least-recently-used order.  It is kept coherent by
+   directory.c, which updates it whenever an entry is added to
+   or removed from a directory. */
+
+/* Number of entries in the cache. */
+#define DCACHE_SIZE 64
+
+/* A cached directory entry. */
+struct dcache_entry
+  {
+    struct hash_elem hash_elem;         /* Element in `dcache'. */
+    struct list_elem lru_elem;          /* Element in `lru_list'. */
+    block_sector_t dir_sector;          /* Parent directory's inode sector. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+    block_sector_t inode_sector;        /* Named inode, if !negative. */
+    bool negative;                      /* True if NAME does not exist. */
+    bool in_use;                        /* In `dcache' or free? */
+  };
+
+static struct dcache_entry entries[DCACHE_SIZE];
+
+/* Cached entries, keyed on parent directory and name. */
+static struct hash dcache;
+
+/* All entries, most recently used at the front.
+   Unused entries are kept at the back. */
+static struct list lru_list;
+
+/* Protects all of the above. */
+static struct lock dcache_lock;
+
+static hash_hash_func dcache_hash;
+static hash_less_func dcache_less;
+static struct dcache_entry *find (block_sector_t dir_sector,
+                                  const char *name);
+static void insert (block_sector_t dir_sector, const char *name,
+                    block_sector_t inode_sector, bool negative);
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  if (!hash_init (&dcache, dcache_hash, dcache_less, NULL))
+    PANIC ("directory entry cache creation failed");
+  list_init (&lru_list);
+  lock_init (&dcache_lock);
+
+  for (i = 0; i < DCACHE_SIZE; i++)
+    {
+      entries[i].in_use = false;
+      list_push_back (&lru_list, &entries[i].lru_elem);
+    }
+}
+
+/* Looks up NAME in the directory whose inode is in DIR_SECTOR.
+   Returns DCACHE_POSITIVE and stores the named inode's sector
+   in *INODE_SECTOR if NAME is cached as existing,
+   DCACHE_NEGATIVE if NAME is cached as not existing, or
+   DCACHE_MISS if nothing is known about NAME. */
+enum dcache_result
+dcache_lookup (block_sector_t dir_sector, const char *name,
+               block_sector_t *inode_sector)
+{
+  enum dcache_result result = DCACHE_MISS;
+  struct dcache_entry *e;
+
+  lock_acquire (&dcache_lock);
+  e = find (dir_sector, name);
+  if (e != NULL)
+    {
+      list_remove (&e->lru_elem);
+      list_push_front (&lru_list, &e->lru_elem);
+      if (e->negative)
+        result = DCACHE_NEGATIVE;
+      else
+        {
+          *inode_sector = e->inode_sector;
+          result = DCACHE_POSITIVE;
+        }
+    }
+  lock_release (&dcache_lock);
+
+  return result;
+}
+
+/* Records that NAME in the directory whose inode is in
+   DIR_SECTOR refers to the inode in INODE_SECTOR. */
+void
+dcache_insert (block_sector_t dir_sector, const char *name,
+               block_sector_t inode_sector)
+{
+  insert (dir_sector, name, inode_sector, false);
+}
+
+/* Records that NAME does not exist in the directory whose inode
+   is in DIR_SECTOR. */
+void
+dcache_insert_negative (block_sector_t dir_sector, const char *name)
+{
+  insert (dir_sector, name, 0, true);
+}
+
+/* Forgets anything known about NAME in the directory whose
+   inode is in DIR_SECTOR. */
+void
+dcache_invalidate (block_sector_t dir_sector, const char *name)
+{
+  struct dcache_entry *e;
+
+  lock_acquire (&dcache_lock);
+  e = find (dir_sector, name);
+  if (e != NULL)
+    {
+      hash_delete (&dcache, &e->hash_elem);
+      e->in_use = false;
+      list_remove (&e->lru_elem);
+      list_push_back (&lru_list, &e->lru_elem);
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Creates or updates the entry for NAME in DIR_SECTOR,
+   recycling the least recently used entry if necessary. */
+static void
+insert (block_sector_t dir_sector, const char *name,
+        block_sector_t inode_sector, bool negative)
+{
+  struct dcache_entry *e;
+
+  /* Names too long to be in a directory are never cached. */
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  e = find (dir_sector, name);
+  if (e == NULL)
+    {
+      e = list_entry (list_back (&lru_list), struct dcache_entry, lru_elem);
+      if (e->in_use)
+        hash_delete (&dcache, &e->hash_elem);
+      e->dir_sector = dir_sector;
+      strlcpy (e->name, name, sizeof e->name);
+      e->in_use = true;
+      hash_insert (&dcache, &e->hash_elem);
+    }
+  e->inode_sector = inode_sector;
+  e->negative = negative;
+  list_remove (&e->lru_elem);
+  list_push_front (&lru_list, &e->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Returns the cached entry for NAME in DIR_SECTOR, or a null
+   pointer if there is none.  The caller must hold
+   dcache_lock. */
+static struct dcache_entry *
+find (block_sector_t dir_sector, const char *name)
+{
+  struct dcache_entry key;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&dcache_lock));
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+  key.dir_sector = dir_sector;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dcache, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dcache_entry, hash_elem) : NULL;
+}
+
+/* Returns a hash value for the dcache entry E. */
+static unsigned
+dcache_hash (const struct hash_elem *e_, void *aux UNUSED)
+{
+  const struct dcache_entry *e = hash_entry (e_, struct dcache_entry,
+                                             hash_elem);
+  return hash_string (e->name) ^ hash_int (e->dir_sector);
+}
+
+/* Returns true if dcache entry A precedes dcache entry B. */
+static bool
+dcache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dcache_entry *a = hash_entry (a_, struct dcache_entry,
+                                             hash_elem);
+  const struct dcache_entry *b = hash_entry (b_, struct dcache_entry,
+                                             hash_elem);
+
+  if (a->dir_sector != b->dir_sector)
+    return a->dir_sector < b->dir_sector;
+  return strcmp (a->name, b->name) < 0;
+}
@@ -0,0 +1,22 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include "devices/block.h"
+
+/* Result of a directory entry cache lookup. */
+enum dcache_result
+  {
+    DCACHE_MISS,                /* Nothing known, must scan directory. */
+    DCACHE_POSITIVE,            /* Name exists, inode sector returned. */
+    DCACHE_NEGATIVE             /* Name is known not to exist. */
+  };
+
+void dcache_init (void);
+enum dcache_result dcache_lookup (block_sector_t dir_sector, const char *name,
+                                  block_sector_t *inode_sector);
+void dcache_insert (block_sector_t dir_sector, const char *name,
+                    block_sector_t inode_sector);
+void dcache_insert_negative (block_sector_t dir_sector, const char *name);
+void dcache_invalidate (block_sector_t dir_sector, const char *name);
+
+#endif /* filesys/dcache.h */
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -39,6 +40,7 @@ dir_open (struct inode *inode)
     {
       dir->inode = inode;
       dir->pos = 0;
+      inode_journal (inode);
       return dir;
     }
   else
@@ -114,20 +116,45 @@ lookup (const struct dir *dir, const char *name,
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
-   a null pointer.  The caller must close *INODE. */
+   a null pointer.  The caller must close *INODE.
+   Consults the directory entry cache first, and caches the
+   result of any directory scan it has to do.
+   Holds DIR's directory lock throughout, so that NAME cannot be
+   removed and its inode freed between finding and opening it. */
 bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode) 
 {
+  block_sector_t dir_sector;
+  block_sector_t inode_sector;
   struct dir_entry e;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
-  else
-    *inode = NULL;
+  *inode = NULL;
+  dir_sector = inode_get_inumber (dir->inode);
+  inode_lock_dir (dir->inode);
+  switch (dcache_lookup (dir_sector, name, &inode_sector))
+    {
+    case DCACHE_POSITIVE:
+      *inode = inode_open (inode_sector);
+      break;
+
+    case DCACHE_NEGATIVE:
+      break;
+
+    case DCACHE_MISS:
+      if (lookup (dir, name, &e, NULL))
+        {
+          dcache_insert (dir_sector, name, e.inode_sector);
+          *inode = inode_open (e.inode_sector);
+        }
+      else
+        dcache_insert_negative (dir_sector, name);
+      break;
+    }
+  inode_unlock_dir (dir->inode);
 
   return *inode != NULL;
 }
@@ -152,6 +179,8 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  inode_lock_dir (dir->inode);
+
   /* Check that NAME is not in use. */
   if (lookup (dir, name, NULL, NULL))
     goto done;
@@ -173,16 +202,25 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  if (success)
+    dcache_insert (inode_get_inumber (dir->inode), name, inode_sector);
+  else
+    dcache_invalidate (inode_get_inumber (dir->inode), name);
 
  done:
+  inode_unlock_dir (dir->inode);
   return success;
 }
 
 /* Removes any entry for NAME in DIR.
    Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   which occurs only if there is no file with the given NAME.
+   On success, stores the removed inode in *INODEP, and the
+   caller must close it.  Closing it frees the file if nobody
+   else has it open, which may take several log operations, so
+   the caller should do so outside of any operation. */
 bool
-dir_remove (struct dir *dir, const char *name) 
+dir_remove (struct dir *dir, const char *name, struct inode **inodep) 
 {
   struct dir_entry e;
   struct inode *inode = NULL;
@@ -192,6 +230,8 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  inode_lock_dir (dir->inode);
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -204,14 +244,21 @@ dir_remove (struct dir *dir, const char *name)
   /* Erase directory entry. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
-    goto done;
+    {
+      dcache_invalidate (inode_get_inumber (dir->inode), name);
+      goto done;
+    }
+  dcache_insert_negative (inode_get_inumber (dir->inode), name);
 
   /* Remove inode. */
   inode_remove (inode);
+  *inodep = inode;
   success = true;
 
  done:
-  inode_close (inode);
+  if (!success)
+    inode_close (inode);
+  inode_unlock_dir (dir->inode);
   return success;
 }
 
@@ -222,15 +269,19 @@ bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  bool success = false;
 
+  inode_lock_dir (dir->inode);
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
       dir->pos += sizeof e;
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
+          success = true;
+          break;
         } 
     }
-  return false;
+  inode_unlock_dir (dir->inode);
+  return success;
 }
@@ -2,6 +2,8 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
 
 /* An open file. */
 struct file 
@@ -87,9 +89,8 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at the file's current position.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file extends the file.
    Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) 
@@ -102,9 +103,8 @@ file_write (struct file *file, const void *buffer, off_t size)
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually written,
-   which may be less than SIZE if end of file is reached.
-   (Normally we'd grow the file in that case, but file growth is
-   not yet implemented.)
+   which may be less than SIZE if the disk is full.
+   Writing past end of file extends the file.
    The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
@@ -113,6 +113,56 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, into DST, starting at its current position.
+   Returns the number of bytes actually copied, which may be less
+   than SIZE if end of file is reached in either file or if a
+   temporary page cannot be allocated.
+   Advances both files' positions by the number of bytes copied.
+
+   The data is copied a page at a time through the buffer cache,
+   so when both positions are sector-aligned every sector is read
+   and written whole.  Copying between overlapping ranges of the
+   same file, open as two different files, is done front to back.
+   DST and SRC must not be the same file, because it has only one
+   position. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size)
+{
+  off_t bytes_copied = 0;
+  uint8_t *buffer;
+
+  ASSERT (dst != NULL);
+  ASSERT (src != NULL);
+  ASSERT (dst != src);
+  ASSERT (size >= 0);
+
+  buffer = palloc_get_page (0);
+  if (buffer == NULL)
+    return 0;
+
+  while (size > 0)
+    {
+      off_t chunk_size = size < PGSIZE ? size : PGSIZE;
+      off_t bytes_read, bytes_written;
+
+      bytes_read = inode_read_at (src->inode, buffer, chunk_size, src->pos);
+      if (bytes_read == 0)
+        break;
+      bytes_written = inode_write_at (dst->inode, buffer, bytes_read,
+                                      dst->pos);
+      src->pos += bytes_written;
+      dst->pos += bytes_written;
+      bytes_copied += bytes_written;
+      size -= bytes_written;
+      if (bytes_written < bytes_read)
+        break;
+    }
+  palloc_free_page (buffer);
+
+  return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
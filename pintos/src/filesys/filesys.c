@@ -2,9 +2,12 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/log.h"
 #include "filesys/directory.h"
 
 /* Partition that contains the file system. */
@@ -21,11 +24,14 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
   inode_init ();
+  dcache_init ();
   free_map_init ();
 
   if (format) 
     do_format ();
+  log_init (format);
 
   free_map_open ();
 }
@@ -35,7 +41,10 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  inode_flush_all ();
   free_map_close ();
+  log_done ();
+  cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -46,14 +55,19 @@ bool
 filesys_create (const char *name, off_t initial_size) 
 {
   block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
+  struct dir *dir;
+  bool success;
+
+  log_begin_op ();
+  dir = dir_open_root ();
+  success = (dir != NULL
                   && free_map_allocate (1, &inode_sector)
                   && inode_create (inode_sector, initial_size)
                   && dir_add (dir, name, inode_sector));
   if (!success && inode_sector != 0) 
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  log_end_op ();
 
   return success;
 }
@@ -83,9 +97,18 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  struct dir *dir;
+  struct inode *inode = NULL;
+  bool success;
+
+  log_begin_op ();
+  dir = dir_open_root ();
+  success = dir != NULL && dir_remove (dir, name, &inode);
   dir_close (dir); 
+  log_end_op ();
+
+  /* Freeing the file's sectors may take operations of its own. */
+  inode_close (inode);
 
   return success;
 }
@@ -99,5 +122,9 @@ do_format (void)
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
   free_map_close ();
+
+  /* The log is not in use yet, so make the new file system
+     durable before it is. */
+  cache_flush ();
   printf ("done.\n");
 }
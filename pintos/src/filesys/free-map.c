@@ -4,9 +4,17 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/log.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static size_t free_cnt;              /* Number of free sectors. */
+static size_t reserved_cnt;          /* Free sectors set aside by
+                                        free_map_reserve(). */
+static struct lock free_map_lock;    /* Protects the above. */
+
+static bool allocate (size_t cnt, block_sector_t *, bool reserved);
 
 /* Initializes the free map. */
 void
@@ -15,38 +23,109 @@ free_map_init (void)
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
+  lock_init (&free_map_lock);
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, LOG_SECTOR, LOG_SECTORS, true);
+  free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
+  reserved_cnt = 0;
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
+   the first into *SECTORP.  Sectors set aside by
+   free_map_reserve() are not used.
    Returns true if successful, false if not enough consecutive
    sectors were available or if the free_map file could not be
-   written. */
+   written.
+   Only the part of the free map file that changes is written,
+   so that an operation logs as few sectors as possible. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  return allocate (cnt, sectorp, false);
+}
+
+/* Like free_map_allocate(), but allocates CNT sectors that the
+   caller set aside with free_map_reserve(), ending their
+   reservation if successful. */
+bool
+free_map_allocate_reserved (size_t cnt, block_sector_t *sectorp)
+{
+  return allocate (cnt, sectorp, true);
+}
+
+/* Sets aside CNT free sectors, without choosing which, so that a
+   later free_map_allocate_reserved() can count on them.
+   Returns false if fewer than CNT sectors are free. */
+bool
+free_map_reserve (size_t cnt)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = free_cnt - reserved_cnt >= cnt;
+  if (success)
+    reserved_cnt += cnt;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Ends the reservation of CNT sectors set aside by
+   free_map_reserve(). */
+void
+free_map_unreserve (size_t cnt)
+{
+  lock_acquire (&free_map_lock);
+  ASSERT (reserved_cnt >= cnt);
+  reserved_cnt -= cnt;
+  lock_release (&free_map_lock);
+}
+
+/* Allocates CNT consecutive sectors and stores the first into
+   *SECTORP, taking them out of the reservation if RESERVED is
+   true and leaving reserved sectors alone otherwise. */
+static bool
+allocate (size_t cnt, block_sector_t *sectorp, bool reserved)
+{
+  block_sector_t sector = BITMAP_ERROR;
+
+  lock_acquire (&free_map_lock);
+  ASSERT (!reserved || reserved_cnt >= cnt);
+  if (reserved || free_cnt - reserved_cnt >= cnt)
+    sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+      && !bitmap_write_range (free_map, free_map_file, sector, cnt))
     {
       bitmap_set_multiple (free_map, sector, cnt, false); 
       sector = BITMAP_ERROR;
     }
+  if (sector != BITMAP_ERROR)
+    {
+      free_cnt -= cnt;
+      if (reserved)
+        reserved_cnt -= cnt;
+    }
+  lock_release (&free_map_lock);
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR available for use.
+   Revokes any of them that are in the log, so that they can be
+   reused for data that is not logged. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  log_revoke (sector, cnt);
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  free_cnt += cnt;
+  if (free_map_file != NULL)
+    bitmap_write_range (free_map, free_map_file, sector, cnt);
+  lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -56,8 +135,10 @@ free_map_open (void)
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_journal (file_get_inode (free_map_file));
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
 }
 
 /* Writes the free map to disk and closes the free map file. */
@@ -72,14 +153,16 @@ free_map_close (void)
 void
 free_map_create (void) 
 {
-  /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  /* Create inode.  The free map cannot allocate sectors for
+     itself, so they must all be allocated now. */
+  if (!inode_create_preallocated (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
     PANIC ("free map creation failed");
 
   /* Write bitmap to file. */
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
   if (free_map_file == NULL)
     PANIC ("can't open free map");
+  inode_journal (file_get_inode (free_map_file));
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
 }
@@ -3,21 +3,41 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/log.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of sector pointers in an index block. */
+#define PTRS_PER_SECTOR (BLOCK_SECTOR_SIZE / sizeof (block_sector_t))
+
+/* Number of data sectors reachable through the inode's direct
+   pointers, its indirect block, and its doubly indirect block. */
+#define DIRECT_CNT 124
+#define INDIRECT_CNT PTRS_PER_SECTOR
+#define DBL_INDIRECT_CNT (PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+
+/* Size of the largest file an inode can address. */
+#define MAX_FILE_SIZE \
+  ((off_t) (DIRECT_CNT + INDIRECT_CNT + DBL_INDIRECT_CNT) * BLOCK_SECTOR_SIZE)
+
 /* On-disk inode.
-   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+   Must be exactly BLOCK_SECTOR_SIZE bytes long.
+   A sector pointer of 0 means that the sector is not allocated,
+   which is safe because sector 0 always holds the free map
+   inode. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    block_sector_t direct[DIRECT_CNT];  /* Direct data sectors. */
+    block_sector_t indirect;            /* Indirect index block. */
+    block_sector_t dbl_indirect;        /* Doubly indirect index block. */
   };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -32,45 +52,178 @@ bytes_to_sectors (off_t size)
 struct inode 
   {
     struct list_elem elem;              /* Element in inode list. */
+    struct list_elem closed_elem;       /* In closed_inodes if unopened. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    bool journaled;                     /* Log writes to data? */
+    struct rwlock rwlock;               /* Shared for reads, exclusive for
+                                           writes and deny_write_cnt. */
+    struct lock dir_lock;               /* Serializes directory operations. */
+    struct list delayed;                /* Delayed blocks, protected by
+                                           rwlock. */
+    size_t delayed_cnt;                 /* Number of delayed blocks. */
+    block_sector_t reserve_start;       /* First reserved sector. */
+    size_t reserve_cnt;                 /* Number of reserved sectors. */
     struct inode_disk data;             /* Inode content. */
   };
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
-static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
-{
-  ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
-  else
-    return -1;
-}
+/* Delayed allocation.
+
+   A write to a part of a regular file that has no sector yet
+   does not allocate one right away.  Instead, the data is held
+   in a "delayed block" from a fixed pool.  An inode's delayed
+   blocks are flushed when it has too many of them, when the pool
+   runs out, when the inode is closed, and at shutdown.  Flushing
+   sees all of an inode's new data at once, so it allocates each
+   run of consecutive delayed blocks as a single contiguous
+   extent.  A file written sequentially is thus
+   laid out sequentially even while other files grow at the same
+   time.
+
+   Creating a delayed block sets aside a free sector for it with
+   free_map_reserve() and allocates any index blocks it will need,
+   so that flushing it cannot run out of space.  If there is no
+   free sector, the write that needed the block comes up short.
+
+   Files whose writes are logged (directories and the free map)
+   are always allocated immediately.
+
+   A caller that knows how large a file will become can reserve
+   an extent for it with inode_reserve().  Sector I of the
+   reservation is then used for sector I of the file's data, so
+   the whole file ends up contiguous however its delayed blocks
+   are flushed.  Reserved sectors that have not been used are
+   released when the inode is closed. */
+
+/* Number of delayed blocks in the pool, and the most that one
+   inode may hold. */
+#define DELAYED_CNT 64
+#define DELAYED_PER_INODE 32
+
+/* Most sectors that inode_reserve() reserves.  Allocating or
+   releasing that many changes at most a few free map sectors,
+   each of which covers BLOCK_SECTOR_SIZE * 8 sectors, so it fits
+   in one log operation. */
+#define RESERVE_MAX (4 * BLOCK_SECTOR_SIZE * 8)
+
+/* A block of file data that has no sector yet. */
+struct delayed_block
+  {
+    struct list_elem elem;              /* In `delayed' or `free_delayed'. */
+    size_t idx;                         /* Sector index within file. */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Contents. */
+  };
+
+static struct delayed_block delayed_blocks[DELAYED_CNT];
+
+/* Delayed blocks not in use, and a lock to protect the list. */
+static struct list free_delayed;
+static struct lock free_delayed_lock;
+
+/* A sector's worth of zeros. */
+static char zeros[BLOCK_SECTOR_SIZE];
+
+static block_sector_t lookup_sector (const struct inode_disk *, size_t idx);
+static bool install_index (struct inode_disk *, size_t idx, bool logged,
+                           block_sector_t *indexp, bool *changedp);
+static bool install_sector (struct inode_disk *, size_t idx,
+                            block_sector_t sector, bool logged,
+                            bool *changedp);
+static block_sector_t allocate_sector (struct inode *, size_t idx);
+static void release_sectors (const struct inode_disk *);
+static void write_back_index (const struct inode_disk *);
+static void write_inode (struct inode *);
+static bool is_zeros (const uint8_t *, size_t);
+static struct delayed_block *find_delayed (struct inode *, size_t idx);
+static bool delayed_full (struct inode *);
+static struct delayed_block *get_delayed (struct inode *, size_t idx,
+                                          bool *allocatedp);
+static void put_delayed (struct delayed_block *);
+static size_t index_region (size_t idx);
+static void flush_delayed (struct inode *);
+static void discard_delayed (struct inode *);
+static bool reserved_sector (const struct inode *, size_t idx,
+                             block_sector_t *);
+static void release_reserve (struct inode *);
+static void begin_write (struct inode *);
+static void end_write (struct inode *);
 
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Also holds recently closed
+   inodes, so that reopening one does not have to read it again. */
 static struct list open_inodes;
 
+/* Inodes in open_inodes that nobody has open, most recently
+   closed first.  Removed inodes are never kept here. */
+#define CLOSED_INODE_CNT 32
+static struct list closed_inodes;
+static size_t closed_cnt;
+
+/* Protects open_inodes, closed_inodes, closed_cnt, and the
+   open_cnt and removed members of every inode in them. */
+static struct lock open_inodes_lock;
+
+static struct inode *find_open_inode (block_sector_t);
+static void open_locked (struct inode *);
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
+  size_t i;
+
   list_init (&open_inodes);
+  list_init (&closed_inodes);
+  closed_cnt = 0;
+  lock_init (&open_inodes_lock);
+
+  list_init (&free_delayed);
+  lock_init (&free_delayed_lock);
+  for (i = 0; i < DELAYED_CNT; i++)
+    list_push_back (&free_delayed, &delayed_blocks[i].elem);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The data is a hole: it reads as zeros, and sectors are
+   allocated for it only as it is written.
    Returns true if successful.
-   Returns false if memory or disk allocation fails. */
+   Returns false if memory allocation fails, or if LENGTH is
+   larger than an inode can address. */
 bool
 inode_create (block_sector_t sector, off_t length)
+{
+  struct inode_disk *disk_inode = NULL;
+
+  ASSERT (length >= 0);
+
+  /* If this assertion fails, the inode structure is not exactly
+     one sector in size, and you should fix that. */
+  ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
+
+  if (length > MAX_FILE_SIZE)
+    return false;
+
+  disk_inode = calloc (1, sizeof *disk_inode);
+  if (disk_inode == NULL)
+    return false;
+
+  disk_inode->length = length;
+  disk_inode->magic = INODE_MAGIC;
+  log_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
+  free (disk_inode);
+  return true;
+}
+
+/* Like inode_create(), but allocates contiguous, zeroed sectors
+   for all LENGTH bytes of data up front.  Needed for the free map,
+   which cannot allocate sectors for itself as it is written.
+   Returns false if memory or disk allocation fails, or if LENGTH
+   is larger than an inode can address. */
+bool
+inode_create_preallocated (block_sector_t sector, off_t length)
 {
   struct inode_disk *disk_inode = NULL;
   bool success = false;
@@ -81,24 +234,43 @@ inode_create (block_sector_t sector, off_t length)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
+  if (length > MAX_FILE_SIZE)
+    return false;
+
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
       size_t sectors = bytes_to_sectors (length);
+      block_sector_t start;
+
       disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
+      if (free_map_allocate (sectors, &start)) 
         {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
+          size_t i;
+          bool changed;
+
+          success = true;
+          for (i = 0; i < sectors; i++) 
+            {
+              if (!install_sector (disk_inode, i, start + i, false,
+                                   &changed))
+                {
+                  release_sectors (disk_inode);
+                  free_map_release (start + i, sectors - i);
+                  success = false;
+                  break;
+                }
+              cache_write (start + i, zeros, 0, BLOCK_SECTOR_SIZE);
+            }
+          if (success)
             {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
+              /* The index blocks are new, so instead of logging
+                 them, write them home before the inode that points
+                 to them can be committed. */
+              write_back_index (disk_inode);
+              log_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
             }
-          success = true; 
         } 
       free (disk_inode);
     }
@@ -111,42 +283,99 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
+  struct inode *other;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
-    }
+  lock_acquire (&open_inodes_lock);
+  inode = find_open_inode (sector);
+  if (inode != NULL)
+    open_locked (inode);
+  lock_release (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
     return NULL;
 
-  /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
+  /* Initialize.  The disk read is done without holding
+     open_inodes_lock, so that opening one inode does not wait
+     for another's disk I/O. */
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  inode->journaled = false;
+  rwlock_init (&inode->rwlock);
+  lock_init (&inode->dir_lock);
+  list_init (&inode->delayed);
+  inode->delayed_cnt = 0;
+  inode->reserve_cnt = 0;
+  cache_read (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+
+  /* Someone else may have opened the same inode while we were
+     reading it.  If so, use theirs. */
+  lock_acquire (&open_inodes_lock);
+  other = find_open_inode (sector);
+  if (other != NULL)
+    open_locked (other);
+  else
+    list_push_front (&open_inodes, &inode->elem);
+  lock_release (&open_inodes_lock);
+
+  if (other != NULL)
+    {
+      free (inode);
+      return other;
+    }
   return inode;
 }
 
+/* Returns the open inode for SECTOR, or a null pointer if there
+   is none.  The caller must hold open_inodes_lock. */
+static struct inode *
+find_open_inode (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&open_inodes_lock));
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        return inode;
+    }
+  return NULL;
+}
+
+/* Adds an opener to INODE, taking it off the closed list if it
+   had none.  The caller must hold open_inodes_lock. */
+static void
+open_locked (struct inode *inode)
+{
+  ASSERT (lock_held_by_current_thread (&open_inodes_lock));
+
+  if (inode->open_cnt++ == 0)
+    {
+      list_remove (&inode->closed_elem);
+      closed_cnt--;
+    }
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -158,31 +387,71 @@ inode_get_inumber (const struct inode *inode)
 }
 
 /* Closes INODE and writes it to disk.
-   If this was the last reference to INODE, frees its memory.
-   If INODE was also a removed inode, frees its blocks. */
+   Allocates sectors for its delayed blocks and releases its
+   unused reserved sectors.
+   If this was the last reference to INODE, puts it on the list of
+   closed inodes, which frees the memory of the least recently
+   closed one if the list is full.
+   If INODE was also a removed inode, frees its blocks and memory
+   instead. */
 void
 inode_close (struct inode *inode) 
 {
+  struct inode *victim = NULL;
+  bool last, free_it;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  /* Give delayed blocks their sectors while INODE is still in
+     the inode list, so that reopening it cannot read an on-disk
+     inode that lacks them. */
+  if (!inode->removed)
+    flush_delayed (inode);
+  begin_write (inode);
+  release_reserve (inode);
+  end_write (inode);
+
+  /* If this was the last opener, remove from inode list if
+     removed, otherwise keep it as a closed inode. */
+  lock_acquire (&open_inodes_lock);
+  last = --inode->open_cnt == 0;
+  free_it = last && inode->removed;
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
-      /* Deallocate blocks if removed. */
-      if (inode->removed) 
+      if (inode->removed)
+        list_remove (&inode->elem);
+      else
         {
-          free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
+          list_push_front (&closed_inodes, &inode->closed_elem);
+          if (++closed_cnt > CLOSED_INODE_CNT)
+            {
+              victim = list_entry (list_pop_back (&closed_inodes),
+                                   struct inode, closed_elem);
+              list_remove (&victim->elem);
+              closed_cnt--;
+            }
         }
+    }
+  lock_release (&open_inodes_lock);
 
+  /* Deallocate blocks if removed and this was the last opener.
+     Otherwise, INODE may be on the closed list, where another
+     thread may reopen or free it, so it must not be touched. */
+  if (free_it)
+    {
+      discard_delayed (inode);
+      log_begin_op ();
+      release_sectors (&inode->data);
+      free_map_release (inode->sector, 1);
+      log_end_op ();
       free (inode); 
     }
+
+  /* A closed inode has no delayed blocks, so it can simply be
+     freed. */
+  free (victim);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -191,24 +460,28 @@ void
 inode_remove (struct inode *inode) 
 {
   ASSERT (inode != NULL);
+  lock_acquire (&open_inodes_lock);
   inode->removed = true;
+  lock_release (&open_inodes_lock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
+   than SIZE if an error occurs or end of file is reached.
+   Any number of reads of INODE may proceed at once. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
+  rwlock_acquire_read (&inode->rwlock);
   while (size > 0) 
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Sector index to read, starting byte offset within sector. */
+      size_t idx = offset / BLOCK_SECTOR_SIZE;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      block_sector_t sector;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
       off_t inode_left = inode_length (inode) - offset;
@@ -220,23 +493,18 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
+      sector = lookup_sector (&inode->data, idx);
+      if (sector != 0)
+        cache_read (sector, buffer + bytes_read, sector_ofs, chunk_size);
+      else
         {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          /* Not yet allocated: either a delayed block or never
+             written, in which case it reads as zeros. */
+          struct delayed_block *db = find_delayed (inode, idx);
+          if (db != NULL)
+            memcpy (buffer + bytes_read, db->data + sector_ofs, chunk_size);
+          else
+            memset (buffer + bytes_read, 0, chunk_size);
         }
       
       /* Advance. */
@@ -244,67 +512,107 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+  rwlock_release_read (&inode->rwlock);
 
   return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk is full, the file reaches the
+   largest size an inode can address, or writes to INODE are
+   denied partway through.
+   A write past end of file extends the inode.
+   Excludes all other reads and writes of INODE while it runs,
+   except between the log operations that a large write of a
+   regular file is split into. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  bool allocated = false;
+
+  if (offset >= MAX_FILE_SIZE)
+    size = 0;
+  else if (size > MAX_FILE_SIZE - offset)
+    size = MAX_FILE_SIZE - offset;
 
+  begin_write (inode);
   if (inode->deny_write_cnt)
-    return 0;
+    {
+      end_write (inode);
+      return 0;
+    }
 
-  while (size > 0) 
+  /* INODE is released briefly between log operations, so check
+     again before each chunk that writes have not been denied. */
+  while (size > 0 && inode->deny_write_cnt == 0) 
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Sector index to write, starting byte offset within sector. */
+      size_t idx = offset / BLOCK_SECTOR_SIZE;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
-
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
+      struct delayed_block *db = NULL;
+      block_sector_t sector;
 
       /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+      int chunk_size = size < sector_left ? size : sector_left;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      sector = lookup_sector (&inode->data, idx);
+      if (sector == 0)
+        db = find_delayed (inode, idx);
+      if (sector == 0 && db == NULL
+          && is_zeros (buffer + bytes_written, chunk_size))
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          /* Writing zeros into a hole leaves it a hole. */
         }
-      else 
+      else if (sector == 0 && db == NULL)
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
+          /* A journaled file's data is logged, so its whole write
+             is one operation.  Otherwise each allocation gets an
+             operation of its own, so that a large write cannot
+             overflow the log. */
+          if (!inode->journaled && allocated)
+            {
+              end_write (inode);
+              begin_write (inode);
+              allocated = false;
+              continue;
+            }
+          if (!inode->journaled && delayed_full (inode))
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
+              end_write (inode);
+              flush_delayed (inode);
+              begin_write (inode);
+              continue;
+            }
+
+          if (!inode->journaled)
+            db = get_delayed (inode, idx, &allocated);
+          if (db == NULL)
+            {
+              /* No delayed block available.  Allocate now. */
+              sector = allocate_sector (inode, idx);
+              allocated = true;
+              if (sector == 0)
                 break;
             }
+        }
 
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
+      if (db != NULL)
+        memcpy (db->data + sector_ofs, buffer + bytes_written, chunk_size);
+      else if (sector != 0)
+        {
+          /* The cache reads the rest of the sector from disk first
+             unless the chunk covers all of it. */
+          if (inode->journaled)
+            log_write (sector, buffer + bytes_written, sector_ofs,
+                       chunk_size);
           else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
+            cache_write (sector, buffer + bytes_written, sector_ofs,
+                         chunk_size);
         }
 
       /* Advance. */
@@ -312,7 +620,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+
+  /* Extend file. */
+  if (offset > inode->data.length)
+    {
+      inode->data.length = offset;
+      write_inode (inode);
+    }
+  end_write (inode);
 
   return bytes_written;
 }
@@ -322,8 +637,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +649,39 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rwlock);
+}
+
+/* Marks INODE as holding file system metadata, such as a
+   directory or the free map.  Writes to its data are then logged
+   and must be made inside a log operation. */
+void
+inode_journal (struct inode *inode)
+{
+  inode->journaled = true;
+}
+
+/* Acquires INODE's directory lock, which directory.c holds
+   across each operation on a directory so that lookups, adds
+   and removes in the same directory are atomic with respect to
+   one another.  It is separate from the readers-writer lock
+   that protects INODE's data, which the directory operations
+   also take. */
+void
+inode_lock_dir (struct inode *inode)
+{
+  lock_acquire (&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock. */
+void
+inode_unlock_dir (struct inode *inode)
+{
+  lock_release (&inode->dir_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -343,3 +690,595 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Reserves a contiguous extent of sectors for the first LENGTH
+   bytes of INODE's data, replacing any earlier reservation.  If
+   there is no extent that large, or LENGTH needs more than
+   RESERVE_MAX sectors, reserves as much as possible.
+   Returns true if any sectors were reserved. */
+bool
+inode_reserve (struct inode *inode, off_t length)
+{
+  size_t cnt;
+  block_sector_t start;
+  bool success = false;
+
+  ASSERT (length >= 0);
+  if (length > MAX_FILE_SIZE)
+    length = MAX_FILE_SIZE;
+  cnt = bytes_to_sectors (length);
+  if (cnt > RESERVE_MAX)
+    cnt = RESERVE_MAX;
+
+  begin_write (inode);
+  release_reserve (inode);
+  if (cnt > 0)
+    {
+      while (cnt > 0 && !free_map_allocate (cnt, &start))
+        cnt /= 2;
+      if (cnt > 0)
+        {
+          inode->reserve_start = start;
+          inode->reserve_cnt = cnt;
+          success = true;
+        }
+    }
+  end_write (inode);
+
+  return success;
+}
+
+/* Allocates sectors for the delayed blocks of every open inode.
+   Called at shutdown, when no other file system activity may be
+   in progress. */
+void
+inode_flush_all (void)
+{
+  struct list_elem *e;
+
+  lock_acquire (&open_inodes_lock);
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      flush_delayed (inode);
+    }
+  lock_release (&open_inodes_lock);
+}
+
+/* Returns entry I of the index block in SECTOR. */
+static block_sector_t
+read_ptr (block_sector_t sector, size_t i)
+{
+  block_sector_t ptr;
+
+  cache_read (sector, &ptr, i * sizeof ptr, sizeof ptr);
+  return ptr;
+}
+
+/* Sets entry I of the index block in SECTOR to PTR, logging the
+   change if LOGGED is true. */
+static void
+write_ptr (block_sector_t sector, size_t i, block_sector_t ptr, bool logged)
+{
+  if (logged)
+    log_write (sector, &ptr, i * sizeof ptr, sizeof ptr);
+  else
+    cache_write (sector, &ptr, i * sizeof ptr, sizeof ptr);
+}
+
+/* Returns the sector that holds sector IDX of the file whose
+   on-disk inode is D, or 0 if that sector is not allocated. */
+static block_sector_t
+lookup_sector (const struct inode_disk *d, size_t idx)
+{
+  block_sector_t child;
+
+  if (idx < DIRECT_CNT)
+    return d->direct[idx];
+  idx -= DIRECT_CNT;
+
+  if (idx < INDIRECT_CNT)
+    return d->indirect != 0 ? read_ptr (d->indirect, idx) : 0;
+  idx -= INDIRECT_CNT;
+
+  if (idx >= DBL_INDIRECT_CNT || d->dbl_indirect == 0)
+    return 0;
+  child = read_ptr (d->dbl_indirect, idx / PTRS_PER_SECTOR);
+  return child != 0 ? read_ptr (child, idx % PTRS_PER_SECTOR) : 0;
+}
+
+/* Allocates a zeroed index block and stores its sector in
+   *SECTORP.  Returns false if the disk is full. */
+static bool
+allocate_index (block_sector_t *sectorp, bool logged)
+{
+  if (!free_map_allocate (1, sectorp))
+    return false;
+  if (logged)
+    log_write (*sectorp, zeros, 0, BLOCK_SECTOR_SIZE);
+  else
+    cache_write (*sectorp, zeros, 0, BLOCK_SECTOR_SIZE);
+  return true;
+}
+
+/* Makes sure that the index blocks that point to sector IDX of
+   the file whose on-disk inode is D exist, allocating them as
+   needed, and stores the one that holds the pointer itself in
+   *INDEXP, or 0 if the pointer is in D.  If any index block is
+   allocated, sets *CHANGEDP to true: D may have changed, and
+   since D is only changed in memory, the caller must write it
+   out.  Changes to index blocks are logged
+   if LOGGED is true; otherwise the caller must write them back
+   with write_back_index().
+   Returns false if an index block cannot be allocated. */
+static bool
+install_index (struct inode_disk *d, size_t idx, bool logged,
+               block_sector_t *indexp, bool *changedp)
+{
+  block_sector_t child;
+
+  if (idx < DIRECT_CNT)
+    {
+      *indexp = 0;
+      return true;
+    }
+  idx -= DIRECT_CNT;
+
+  if (idx < INDIRECT_CNT)
+    {
+      if (d->indirect == 0)
+        {
+          if (!allocate_index (&d->indirect, logged))
+            return false;
+          *changedp = true;
+        }
+      *indexp = d->indirect;
+      return true;
+    }
+  idx -= INDIRECT_CNT;
+
+  ASSERT (idx < DBL_INDIRECT_CNT);
+  if (d->dbl_indirect == 0)
+    {
+      if (!allocate_index (&d->dbl_indirect, logged))
+        return false;
+      *changedp = true;
+    }
+  child = read_ptr (d->dbl_indirect, idx / PTRS_PER_SECTOR);
+  if (child == 0)
+    {
+      if (!allocate_index (&child, logged))
+        return false;
+      write_ptr (d->dbl_indirect, idx / PTRS_PER_SECTOR, child, logged);
+      *changedp = true;
+    }
+  *indexp = child;
+  return true;
+}
+
+/* Makes SECTOR hold sector IDX of the file whose on-disk inode is
+   D, allocating index blocks as needed.  Sets *CHANGEDP to true
+   if D may have changed, in which case the caller must write it
+   out.
+   Returns false if an index block cannot be allocated. */
+static bool
+install_sector (struct inode_disk *d, size_t idx, block_sector_t sector,
+                bool logged, bool *changedp)
+{
+  block_sector_t index;
+
+  if (!install_index (d, idx, logged, &index, changedp))
+    return false;
+  if (index == 0)
+    {
+      d->direct[idx] = sector;
+      *changedp = true;
+    }
+  else
+    write_ptr (index, (idx - DIRECT_CNT) % PTRS_PER_SECTOR, sector, logged);
+  return true;
+}
+
+/* Allocates a zeroed sector to hold sector IDX of INODE's data,
+   and writes INODE's on-disk inode if it changes.  Returns the
+   new sector, or 0 if the disk is full.  Must be called inside a
+   log operation. */
+static block_sector_t
+allocate_sector (struct inode *inode, size_t idx)
+{
+  block_sector_t sector;
+  bool reserved = reserved_sector (inode, idx, &sector);
+  bool changed = false;
+
+  if (!reserved && !free_map_allocate (1, &sector))
+    return 0;
+  if (!install_sector (&inode->data, idx, sector, true, &changed))
+    {
+      if (!reserved)
+        free_map_release (sector, 1);
+      if (changed)
+        write_inode (inode);
+      return 0;
+    }
+  if (inode->journaled)
+    log_write (sector, zeros, 0, BLOCK_SECTOR_SIZE);
+  else
+    cache_write (sector, zeros, 0, BLOCK_SECTOR_SIZE);
+  if (changed)
+    write_inode (inode);
+  return sector;
+}
+
+/* Releases SECTOR, which belongs to a file being freed.  A
+   large file touches more free map sectors than one log
+   operation may log, so this may start a new operation.  A
+   crash in between only leaks the sectors not yet released,
+   because the file's inode is released last. */
+static void
+release_sector (block_sector_t sector)
+{
+  free_map_release (sector, 1);
+  log_renew_op ();
+}
+
+/* Releases every sector in the index block in SECTOR, then the
+   index block itself. */
+static void
+release_index (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < PTRS_PER_SECTOR; i++)
+    {
+      block_sector_t ptr = read_ptr (sector, i);
+      if (ptr != 0)
+        release_sector (ptr);
+    }
+  release_sector (sector);
+}
+
+/* Releases all of the data and index sectors of the file whose
+   on-disk inode is D. */
+static void
+release_sectors (const struct inode_disk *d)
+{
+  size_t i;
+
+  for (i = 0; i < DIRECT_CNT; i++)
+    if (d->direct[i] != 0)
+      release_sector (d->direct[i]);
+  if (d->indirect != 0)
+    release_index (d->indirect);
+  if (d->dbl_indirect != 0)
+    {
+      for (i = 0; i < PTRS_PER_SECTOR; i++)
+        {
+          block_sector_t child = read_ptr (d->dbl_indirect, i);
+          if (child != 0)
+            release_index (child);
+        }
+      release_sector (d->dbl_indirect);
+    }
+}
+
+/* Writes every index block of the file whose on-disk inode is D
+   to disk. */
+static void
+write_back_index (const struct inode_disk *d)
+{
+  size_t i;
+
+  if (d->indirect != 0)
+    cache_write_back (d->indirect);
+  if (d->dbl_indirect != 0)
+    {
+      for (i = 0; i < PTRS_PER_SECTOR; i++)
+        {
+          block_sector_t child = read_ptr (d->dbl_indirect, i);
+          if (child != 0)
+            cache_write_back (child);
+        }
+      cache_write_back (d->dbl_indirect);
+    }
+}
+
+/* Writes INODE's on-disk inode to the cache and logs it.  Must
+   be called inside a log operation. */
+static void
+write_inode (struct inode *inode)
+{
+  log_write (inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+}
+
+/* Returns true if the SIZE bytes in BUFFER are all zero. */
+static bool
+is_zeros (const uint8_t *buffer, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (buffer[i] != 0)
+      return false;
+  return true;
+}
+
+/* Returns INODE's delayed block for sector IDX, or a null
+   pointer if it has none.  The caller must hold INODE's rwlock. */
+static struct delayed_block *
+find_delayed (struct inode *inode, size_t idx)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&inode->delayed); e != list_end (&inode->delayed);
+       e = list_next (e))
+    {
+      struct delayed_block *db = list_entry (e, struct delayed_block, elem);
+      if (db->idx == idx)
+        return db;
+    }
+  return NULL;
+}
+
+/* Removes and returns a block from the free pool, or returns a
+   null pointer if the pool is empty. */
+static struct delayed_block *
+take_free_delayed (void)
+{
+  struct delayed_block *db = NULL;
+
+  lock_acquire (&free_delayed_lock);
+  if (!list_empty (&free_delayed))
+    db = list_entry (list_pop_front (&free_delayed),
+                     struct delayed_block, elem);
+  lock_release (&free_delayed_lock);
+  return db;
+}
+
+/* Returns true if delayed block A precedes B in its file. */
+static bool
+delayed_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct delayed_block *a = list_entry (a_, struct delayed_block, elem);
+  const struct delayed_block *b = list_entry (b_, struct delayed_block, elem);
+
+  return a->idx < b->idx;
+}
+
+/* Returns true if INODE should flush its delayed blocks before
+   it gets another one, because it has as many as it may or
+   because the pool is empty.  The caller must hold INODE's
+   rwlock. */
+static bool
+delayed_full (struct inode *inode)
+{
+  bool empty;
+
+  if (inode->delayed_cnt >= DELAYED_PER_INODE)
+    return true;
+
+  lock_acquire (&free_delayed_lock);
+  empty = list_empty (&free_delayed);
+  lock_release (&free_delayed_lock);
+  return empty && inode->delayed_cnt > 0;
+}
+
+/* Creates a zeroed delayed block for sector IDX of INODE, which
+   must not have one already.  Sets aside a free sector for it
+   and allocates the index blocks it will need, setting
+   *ALLOCATEDP to true if any were allocated.  Returns a null
+   pointer if no delayed block is available or the disk is full,
+   in which case the caller should try to allocate a sector right
+   away.  Must be called inside a log operation, with INODE's
+   rwlock held for writing. */
+static struct delayed_block *
+get_delayed (struct inode *inode, size_t idx, bool *allocatedp)
+{
+  struct delayed_block *db;
+  block_sector_t index;
+  bool installed;
+  bool changed = false;
+
+  ASSERT (find_delayed (inode, idx) == NULL);
+
+  db = take_free_delayed ();
+  if (db == NULL)
+    return NULL;
+  if (!free_map_reserve (1))
+    {
+      put_delayed (db);
+      return NULL;
+    }
+  installed = install_index (&inode->data, idx, true, &index, &changed);
+  if (changed)
+    {
+      write_inode (inode);
+      *allocatedp = true;
+    }
+  if (!installed)
+    {
+      free_map_unreserve (1);
+      put_delayed (db);
+      return NULL;
+    }
+
+  db->idx = idx;
+  memset (db->data, 0, BLOCK_SECTOR_SIZE);
+  list_insert_ordered (&inode->delayed, &db->elem, delayed_less, NULL);
+  inode->delayed_cnt++;
+  return db;
+}
+
+/* Returns DB to the free pool. */
+static void
+put_delayed (struct delayed_block *db)
+{
+  lock_acquire (&free_delayed_lock);
+  list_push_back (&free_delayed, &db->elem);
+  lock_release (&free_delayed_lock);
+}
+
+/* Returns a number identifying the index block, if any, that
+   points to sector IDX of a file.  All sectors with the same
+   number are installed by changing the same index block. */
+static size_t
+index_region (size_t idx)
+{
+  if (idx < DIRECT_CNT)
+    return 0;
+  if (idx < DIRECT_CNT + INDIRECT_CNT)
+    return 1;
+  return 2 + (idx - DIRECT_CNT - INDIRECT_CNT) / PTRS_PER_SECTOR;
+}
+
+/* Allocates sectors for all of INODE's delayed blocks and writes
+   them to disk.  Each run of consecutive blocks that is covered
+   by a single index block is allocated as one extent if
+   possible, in a log operation of its own.  The data is written
+   before the operation commits, so that a crash can never leave
+   the file pointing to a sector whose data was not written.
+   Every delayed block has a sector set aside and its index
+   blocks allocated already, so this cannot run out of space.
+   The caller must not hold INODE's rwlock. */
+static void
+flush_delayed (struct inode *inode)
+{
+  for (;;)
+    {
+      struct delayed_block *first, *db;
+      struct list_elem *e;
+      block_sector_t start;
+      size_t run = 1;
+      size_t i;
+      bool changed = false;
+
+      begin_write (inode);
+      if (list_empty (&inode->delayed))
+        {
+          end_write (inode);
+          break;
+        }
+
+      /* Find a run of consecutive blocks. */
+      first = list_entry (list_front (&inode->delayed),
+                          struct delayed_block, elem);
+      for (e = list_next (&first->elem); e != list_end (&inode->delayed);
+           e = list_next (e))
+        {
+          db = list_entry (e, struct delayed_block, elem);
+          if (db->idx != first->idx + run
+              || index_region (db->idx) != index_region (first->idx))
+            break;
+          run++;
+        }
+
+      /* Use reserved sectors for the part of the run inside the
+         reservation, which always starts at the file's first
+         sector, and give back the free sectors set aside for it.
+         Otherwise, allocate as much of the run as possible in one
+         extent from the sectors set aside. */
+      if (first->idx < inode->reserve_cnt)
+        {
+          if (first->idx + run > inode->reserve_cnt)
+            run = inode->reserve_cnt - first->idx;
+          start = inode->reserve_start + first->idx;
+          free_map_unreserve (run);
+        }
+      else
+        while (!free_map_allocate_reserved (run, &start))
+          {
+            ASSERT (run > 1);
+            run /= 2;
+          }
+
+      for (i = 0; i < run; i++)
+        {
+          db = list_entry (list_pop_front (&inode->delayed),
+                           struct delayed_block, elem);
+          inode->delayed_cnt--;
+          if (!install_sector (&inode->data, db->idx, start + i, true,
+                               &changed))
+            NOT_REACHED ();
+          cache_write (start + i, db->data, 0, BLOCK_SECTOR_SIZE);
+          cache_write_back (start + i);
+          put_delayed (db);
+        }
+      if (changed)
+        write_inode (inode);
+      end_write (inode);
+    }
+}
+
+/* Throws away all of INODE's delayed blocks.  The caller must
+   hold INODE's rwlock for writing, or be its last opener. */
+static void
+discard_delayed (struct inode *inode)
+{
+  free_map_unreserve (inode->delayed_cnt);
+  while (!list_empty (&inode->delayed))
+    put_delayed (list_entry (list_pop_front (&inode->delayed),
+                              struct delayed_block, elem));
+  inode->delayed_cnt = 0;
+}
+
+/* If INODE has a reserved sector for sector IDX of its data,
+   stores it in *SECTORP and returns true.  Otherwise, returns
+   false.  The caller must hold INODE's rwlock for writing. */
+static bool
+reserved_sector (const struct inode *inode, size_t idx,
+                 block_sector_t *sectorp)
+{
+  if (idx >= inode->reserve_cnt)
+    return false;
+  *sectorp = inode->reserve_start + idx;
+  return true;
+}
+
+/* Releases the reserved sectors that INODE has not used for its
+   data, and forgets its reservation.  Must be called inside a
+   log operation, with INODE's rwlock held for writing. */
+static void
+release_reserve (struct inode *inode)
+{
+  size_t i, unused = 0;
+
+  if (inode->reserve_cnt == 0)
+    return;
+
+  /* Release each run of unused sectors at once. */
+  for (i = 0; i <= inode->reserve_cnt; i++)
+    {
+      block_sector_t sector = inode->reserve_start + i;
+      if (i < inode->reserve_cnt
+          && lookup_sector (&inode->data, i) != sector)
+        unused++;
+      else if (unused > 0)
+        {
+          free_map_release (sector - unused, unused);
+          unused = 0;
+        }
+    }
+  inode->reserve_cnt = 0;
+}
+
+/* Begins a log operation, then acquires INODE's rwlock for
+   writing.  Everything that does both does them in this order,
+   so that no thread waits for the log while holding an inode
+   that a thread in an operation, such as filesys_remove()
+   closing it, may be waiting for. */
+static void
+begin_write (struct inode *inode)
+{
+  log_begin_op ();
+  rwlock_acquire_write (&inode->rwlock);
+}
+
+/* Releases INODE's rwlock and ends the log operation begun by
+   begin_write(). */
+static void
+end_write (struct inode *inode)
+{
+  rwlock_release_write (&inode->rwlock);
+  log_end_op ();
+}
@@ -9,6 +9,7 @@ struct bitmap;
 
 void inode_init (void);
 bool inode_create (block_sector_t, off_t);
+bool inode_create_preallocated (block_sector_t, off_t);
 struct inode *inode_open (block_sector_t);
 struct inode *inode_reopen (struct inode *);
 block_sector_t inode_get_inumber (const struct inode *);
@@ -18,6 +19,11 @@ off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+void inode_journal (struct inode *);
+void inode_lock_dir (struct inode *);
+void inode_unlock_dir (struct inode *);
 off_t inode_length (const struct inode *);
+bool inode_reserve (struct inode *, off_t length);
+void inode_flush_all (void);
 
 #endif /* filesys/inode.h */
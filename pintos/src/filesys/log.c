@@ -0,0 +1,400 @@
+#include "filesys/log.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Write-ahead log for file system metadata.
+
+   Every change to metadata (inodes, directories, and the free
+   map) is made inside an "operation", bracketed by
+   log_begin_op() and log_end_op().  An operation modifies
+   sectors with log_write(), which pins each one in the buffer
+   cache before changing it, so that it cannot reach its home
+   location on disk early.
+
+   Operations that run at the same time are grouped into a single
+   transaction.  When the last of them ends, the transaction is
+   committed: copies of all of its sectors are written to the log
+   region, one after another, and then the log header is updated
+   to include them.  Writing the header is the commit point.
+   After that the cached sectors are unpinned, and they reach
+   their home locations whenever the cache evicts or flushes them.
+
+   Committed transactions accumulate in the log until it is more
+   than half full.  Then the log is checkpointed: every sector in
+   it is written back home and the header is emptied.  If the
+   machine crashes, log_init() copies the sectors in the log to
+   their home locations at the next boot, in log order, so that
+   either all or none of each transaction's changes survive.
+
+   A logged sector may be freed and then reused for file data,
+   which is not logged.  Replaying the old copy would then
+   overwrite the data, so freeing a sector that is in the log
+   "revokes" it with log_revoke(): the header lists it, and
+   log_init() skips its copies.  Logging it again cancels the
+   revocation, because the new copy comes later in the log. */
+
+/* Identifies a log header. */
+#define LOG_MAGIC 0x4c4f4721
+
+/* Number of sectors in the log that hold logged data. */
+#define LOG_DATA_SECTORS (LOG_SECTORS - 1)
+
+/* Most sectors that a single operation may log, including any
+   operations nested inside it.  Creating a file logs the free
+   map sectors for its inode and data, the new inode, and the
+   directory entry, which may span two sectors.  If the directory
+   has to grow, that adds its inode, a new data sector, and up to
+   three index blocks.  An operation that may log more, such as
+   freeing a whole file, calls log_renew_op() as it goes. */
+#define LOG_OP_SECTORS 12
+
+/* On-disk log header.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct log_header
+  {
+    unsigned magic;                     /* Magic number. */
+    uint32_t n;                         /* Number of logged sectors. */
+    block_sector_t sectors[LOG_DATA_SECTORS]; /* Home of each. */
+    uint32_t revoked_cnt;               /* Number of revoked sectors. */
+    block_sector_t revoked[LOG_DATA_SECTORS]; /* Not to be replayed. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 12 - 8 * LOG_DATA_SECTORS];
+  };
+
+/* The log header as committed to disk.  Written only by the
+   thread that is committing or checkpointing. */
+static struct log_header header;
+
+/* Buffer for copying sectors into or out of the log. */
+static uint8_t log_buffer[BLOCK_SECTOR_SIZE];
+
+/* Protects the members below. */
+static struct lock log_lock;
+
+/* Signaled when an operation ends or a commit finishes. */
+static struct condition log_changed;
+
+static bool log_active;                 /* Recovery done? */
+static int outstanding;                 /* Operations in progress. */
+static bool committing;                 /* Commit in progress? */
+static size_t committed;                /* Sectors in log, per header. */
+static size_t pending_cnt;              /* Sectors in current transaction. */
+static block_sector_t pending[LOG_DATA_SECTORS];
+
+/* Revoked sectors, including those revoked by the current
+   transaction.  Only sectors in the log are revoked, so there
+   can be no more of them than it holds. */
+static size_t revoked_cnt;
+static block_sector_t revoked[LOG_DATA_SECTORS];
+
+static bool is_revoked (block_sector_t);
+static void unrevoke (block_sector_t);
+static void commit (void);
+static void checkpoint (void);
+static void write_header (void);
+
+/* Initializes the log.  If FORMAT is true, empties it;
+   otherwise, replays any transactions committed to it before the
+   last shutdown or crash. */
+void
+log_init (bool format)
+{
+  ASSERT (sizeof header == BLOCK_SECTOR_SIZE);
+
+  lock_init (&log_lock);
+  cond_init (&log_changed);
+
+  block_read (fs_device, LOG_SECTOR, &header);
+  if (!format && header.magic == LOG_MAGIC && header.n > 0
+      && header.n <= LOG_DATA_SECTORS
+      && header.revoked_cnt <= LOG_DATA_SECTORS)
+    {
+      size_t i;
+
+      printf ("filesys: replaying %"PRIu32" logged sectors.\n", header.n);
+      revoked_cnt = header.revoked_cnt;
+      memcpy (revoked, header.revoked, sizeof revoked);
+      for (i = 0; i < header.n; i++)
+        {
+          if (is_revoked (header.sectors[i]))
+            continue;
+          block_read (fs_device, LOG_SECTOR + 1 + i, log_buffer);
+          block_write (fs_device, header.sectors[i], log_buffer);
+        }
+    }
+  header.magic = LOG_MAGIC;
+  header.n = 0;
+  header.revoked_cnt = 0;
+  write_header ();
+
+  committed = 0;
+  pending_cnt = 0;
+  revoked_cnt = 0;
+  outstanding = 0;
+  committing = false;
+  log_active = true;
+}
+
+/* Writes everything in the log to its home location and empties
+   the log.  No operation may be in progress. */
+void
+log_done (void)
+{
+  ASSERT (outstanding == 0);
+
+  if (log_active)
+    checkpoint ();
+}
+
+/* Begins a file system operation.  Waits, if necessary, until
+   the log has room for everything it might log.  Operations may
+   nest; only the outermost one counts.  Does nothing before
+   log_init(), while the file system is being formatted. */
+void
+log_begin_op (void)
+{
+  struct thread *t = thread_current ();
+
+  if (!log_active)
+    return;
+  if (t->log_depth++ > 0)
+    return;
+
+  lock_acquire (&log_lock);
+  while (committing
+         || (committed + pending_cnt + (outstanding + 1) * LOG_OP_SECTORS
+             > LOG_DATA_SECTORS))
+    cond_wait (&log_changed, &log_lock);
+  outstanding++;
+  lock_release (&log_lock);
+}
+
+/* Ends a file system operation.  If it was the last one in its
+   transaction, commits the transaction. */
+void
+log_end_op (void)
+{
+  struct thread *t = thread_current ();
+  bool do_commit = false;
+
+  if (!log_active)
+    return;
+  ASSERT (t->log_depth > 0);
+  if (--t->log_depth > 0)
+    return;
+
+  lock_acquire (&log_lock);
+  ASSERT (outstanding > 0);
+  if (--outstanding == 0)
+    {
+      do_commit = true;
+      committing = true;
+    }
+  else
+    cond_broadcast (&log_changed, &log_lock);
+  lock_release (&log_lock);
+
+  if (do_commit)
+    {
+      /* No other operation can start until COMMITTING is
+         cleared, so the log is ours. */
+      commit ();
+      if (committed + 2 * LOG_OP_SECTORS > LOG_DATA_SECTORS)
+        checkpoint ();
+
+      lock_acquire (&log_lock);
+      committing = false;
+      cond_broadcast (&log_changed, &log_lock);
+      lock_release (&log_lock);
+    }
+}
+
+/* Lets the calling thread's operation, which may log more than
+   LOG_OP_SECTORS sectors in all, go on logging: if the log is
+   too full for the operations in progress, ends the operation
+   and begins a new one.  The caller must be at a point where a
+   crash would leave the file system consistent, and must not
+   hold a lock that another operation may wait for.  Has no
+   effect in a nested operation. */
+void
+log_renew_op (void)
+{
+  bool full;
+
+  if (!log_active || thread_current ()->log_depth != 1)
+    return;
+
+  lock_acquire (&log_lock);
+  full = (committed + pending_cnt + outstanding * LOG_OP_SECTORS
+          > LOG_DATA_SECTORS);
+  lock_release (&log_lock);
+  if (full)
+    {
+      log_end_op ();
+      log_begin_op ();
+    }
+}
+
+/* Writes SIZE bytes from BUFFER into SECTOR starting at byte
+   OFS, through the buffer cache, as part of the current
+   operation, so that SECTOR belongs to the current transaction.
+   A sector modified more than once in a transaction is logged
+   only once. */
+void
+log_write (block_sector_t sector, const void *buffer, int ofs, int size)
+{
+  size_t i;
+
+  if (!log_active)
+    {
+      cache_write (sector, buffer, ofs, size);
+      return;
+    }
+  ASSERT (thread_current ()->log_depth > 0);
+
+  lock_acquire (&log_lock);
+  unrevoke (sector);
+  for (i = 0; i < pending_cnt; i++)
+    if (pending[i] == sector)
+      break;
+  if (i == pending_cnt)
+    {
+      /* Pin the sector as part of modifying it, while holding
+         log_lock, so that another operation in the transaction
+         cannot modify it unpinned in between. */
+      if (committed + pending_cnt >= LOG_DATA_SECTORS)
+        PANIC ("file system operation too large for log");
+      pending[pending_cnt++] = sector;
+      cache_write_pinned (sector, buffer, ofs, size);
+      lock_release (&log_lock);
+    }
+  else
+    {
+      /* Already pinned until the transaction commits, which
+         cannot happen before this operation ends. */
+      lock_release (&log_lock);
+      cache_write (sector, buffer, ofs, size);
+    }
+}
+
+/* Revokes the CNT sectors starting at SECTOR, which are being
+   freed, so that their copies in the log are not replayed.  Must
+   be called inside a log operation, which commits the
+   revocation. */
+void
+log_revoke (block_sector_t sector, size_t cnt)
+{
+  size_t i;
+
+  if (!log_active)
+    return;
+  ASSERT (thread_current ()->log_depth > 0);
+
+  lock_acquire (&log_lock);
+  for (; cnt > 0; sector++, cnt--)
+    {
+      if (is_revoked (sector))
+        continue;
+      for (i = 0; i < committed; i++)
+        if (header.sectors[i] == sector)
+          break;
+      if (i == committed)
+        for (i = 0; i < pending_cnt; i++)
+          if (pending[i] == sector)
+            break;
+      if (i < committed || i < pending_cnt)
+        {
+          ASSERT (revoked_cnt < LOG_DATA_SECTORS);
+          revoked[revoked_cnt++] = sector;
+        }
+    }
+  lock_release (&log_lock);
+}
+
+/* Returns true if SECTOR has been revoked.  The caller must hold
+   log_lock, unless the log is not active yet. */
+static bool
+is_revoked (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < revoked_cnt; i++)
+    if (revoked[i] == sector)
+      return true;
+  return false;
+}
+
+/* Cancels the revocation of SECTOR, if any, because it is being
+   logged again.  The caller must hold log_lock. */
+static void
+unrevoke (block_sector_t sector)
+{
+  size_t i;
+
+  for (i = 0; i < revoked_cnt; i++)
+    if (revoked[i] == sector)
+      {
+        revoked[i] = revoked[--revoked_cnt];
+        return;
+      }
+}
+
+/* Commits the current transaction.  Must be called only by the
+   thread that set COMMITTING. */
+static void
+commit (void)
+{
+  size_t i;
+
+  if (pending_cnt == 0)
+    return;
+
+  /* Copy each sector after the ones already in the log. */
+  for (i = 0; i < pending_cnt; i++)
+    {
+      cache_read (pending[i], log_buffer, 0, BLOCK_SECTOR_SIZE);
+      block_write (fs_device, LOG_SECTOR + 1 + committed + i, log_buffer);
+      header.sectors[committed + i] = pending[i];
+    }
+
+  /* Commit point. */
+  header.n = committed + pending_cnt;
+  header.revoked_cnt = revoked_cnt;
+  memcpy (header.revoked, revoked, sizeof revoked);
+  write_header ();
+
+  /* The sectors may now be written home at any time. */
+  for (i = 0; i < pending_cnt; i++)
+    cache_unpin (pending[i]);
+  committed += pending_cnt;
+  pending_cnt = 0;
+}
+
+/* Writes every sector in the log home and empties the log.
+   Must be called only by the thread that set COMMITTING, or when
+   no operations are possible. */
+static void
+checkpoint (void)
+{
+  size_t i;
+
+  for (i = 0; i < committed; i++)
+    cache_write_back (header.sectors[i]);
+  header.n = 0;
+  header.revoked_cnt = 0;
+  write_header ();
+  committed = 0;
+  revoked_cnt = 0;
+}
+
+/* Writes the log header to disk. */
+static void
+write_header (void)
+{
+  block_write (fs_device, LOG_SECTOR, &header);
+}
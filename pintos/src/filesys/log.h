@@ -0,0 +1,20 @@
+#ifndef FILESYS_LOG_H
+#define FILESYS_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+
+/* Number of sectors in the log, starting at LOG_SECTOR: one
+   header sector followed by copies of logged sectors. */
+#define LOG_SECTORS 48
+
+void log_init (bool format);
+void log_done (void);
+void log_begin_op (void);
+void log_end_op (void);
+void log_renew_op (void);
+void log_write (block_sector_t, const void *, int ofs, int size);
+void log_revoke (block_sector_t, size_t cnt);
+
+#endif /* filesys/log.h */
@@ -0,0 +1,34 @@
+#ifndef __LIB_BLOCK_STATS_H
+#define __LIB_BLOCK_STATS_H
+
+/* Statistics about the requests carried out by a block device,
+   shared by the kernel and by user programs, which get them with
+   the block_stats() system call. */
+
+/* Number of buckets in each histogram.  Bucket 0 counts values
+   of 0, bucket I counts values from 2**(I-1) to 2**I - 1, and the
+   last bucket also counts every larger value. */
+#define BLOCK_HIST_CNT 16
+
+struct block_stats
+  {
+    unsigned long long read_cnt;        /* Sectors read. */
+    unsigned long long write_cnt;       /* Sectors written. */
+    unsigned long long request_cnt;     /* Requests completed. */
+    unsigned long long sequential_cnt;  /* Requests that started at the
+                                           sector after the previous
+                                           request's last. */
+    unsigned long long service_ns;      /* Total nanoseconds from
+                                           submitting requests to
+                                           completing them. */
+    unsigned max_depth;                 /* Most requests outstanding at
+                                           once. */
+    unsigned long long service_hist[BLOCK_HIST_CNT];
+                                        /* Requests by microseconds of
+                                           service time. */
+    unsigned long long size_hist[BLOCK_HIST_CNT];
+                                        /* Requests by number of
+                                           sectors. */
+  };
+
+#endif /* lib/block-stats.h */
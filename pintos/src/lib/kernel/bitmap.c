@@ -359,6 +359,28 @@ bitmap_write (const struct bitmap *b, struct file *file)
   off_t size = byte_cnt (b->bit_cnt);
   return file_write_at (file, b->bits, size, 0) == size;
 }
+
+/* Writes the part of B that holds the CNT bits starting at START
+   to FILE, which must already hold the rest of B.  Return true
+   if successful, false otherwise. */
+bool
+bitmap_write_range (const struct bitmap *b, struct file *file,
+                    size_t start, size_t cnt)
+{
+  size_t first, last;
+  off_t size;
+
+  ASSERT (start <= b->bit_cnt);
+  ASSERT (cnt <= b->bit_cnt - start);
+  if (cnt == 0)
+    return true;
+
+  first = elem_idx (start);
+  last = elem_idx (start + cnt - 1);
+  size = (last - first + 1) * sizeof (elem_type);
+  return file_write_at (file, b->bits + first, size,
+                        first * sizeof (elem_type)) == size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
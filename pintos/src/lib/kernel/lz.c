@@ -0,0 +1,203 @@
+/* LZ77-family data compression.
+
+   See lz.h for the compressed format. */
+
+#include "lz.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "../debug.h"
+
+/* Number of entries in the hash table of recent positions. */
+#define HASH_BITS 9
+#define HASH_CNT (1 << HASH_BITS)
+
+/* Marks an empty hash table entry. */
+#define NO_POS 0xffff
+
+/* Returns the 4 bytes at P as an integer. */
+static uint32_t
+read32 (const uint8_t *p)
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Returns the hash table index for the 4 bytes X. */
+static unsigned
+hash4 (uint32_t x)
+{
+  return (x * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Output position for compression. */
+struct output
+  {
+    uint8_t *p;                 /* Next byte to write. */
+    uint8_t *end;               /* End of space. */
+  };
+
+/* Appends BYTE to OUT.  Returns false if OUT is full. */
+static bool
+put_byte (struct output *out, uint8_t byte)
+{
+  if (out->p >= out->end)
+    return false;
+  *out->p++ = byte;
+  return true;
+}
+
+/* Appends the part of length LENGTH that doesn't fit in a token
+   nibble, if any, to OUT.  Returns false if OUT is full. */
+static bool
+put_length (struct output *out, size_t length)
+{
+  if (length < 15)
+    return true;
+  for (length -= 15; length >= 255; length -= 255)
+    if (!put_byte (out, 255))
+      return false;
+  return put_byte (out, length);
+}
+
+/* Appends a sequence to OUT: the LIT_CNT literal bytes at LIT,
+   followed by a copy of MATCH_LEN bytes from DISTANCE bytes back,
+   or no copy if MATCH_LEN is 0.  Returns false if OUT is full. */
+static bool
+put_sequence (struct output *out, const uint8_t *lit, size_t lit_cnt,
+              size_t distance, size_t match_len)
+{
+  size_t match_code = match_len > 0 ? match_len - LZ_MIN_MATCH : 0;
+
+  if (!put_byte (out, ((lit_cnt < 15 ? lit_cnt : 15) << 4)
+                      | (match_code < 15 ? match_code : 15))
+      || !put_length (out, lit_cnt)
+      || (size_t) (out->end - out->p) < lit_cnt)
+    return false;
+  memcpy (out->p, lit, lit_cnt);
+  out->p += lit_cnt;
+
+  if (match_len == 0)
+    return true;
+  return (put_byte (out, distance & 0xff)
+          && put_byte (out, distance >> 8)
+          && put_length (out, match_code));
+}
+
+/* Compresses the SIZE bytes at SRC into the CAPACITY bytes at
+   DST, using the LZ_WORK_SIZE bytes at WORK as scratch space.
+   Returns the number of bytes of compressed data, or 0 if it
+   would not fit in CAPACITY bytes. */
+size_t
+lz_compress (const void *src_, size_t size, void *dst, size_t capacity,
+             void *work)
+{
+  const uint8_t *src = src_;
+  uint16_t *table = work;
+  struct output out;
+  size_t anchor = 0;
+  size_t pos = 0;
+  size_t i;
+
+  ASSERT (size <= LZ_MAX_INPUT);
+  ASSERT (HASH_CNT * sizeof *table <= LZ_WORK_SIZE);
+
+  for (i = 0; i < HASH_CNT; i++)
+    table[i] = NO_POS;
+  out.p = dst;
+  out.end = out.p + capacity;
+
+  while (pos + LZ_MIN_MATCH <= size)
+    {
+      uint32_t x = read32 (src + pos);
+      unsigned h = hash4 (x);
+      size_t ref = table[h];
+
+      table[h] = pos;
+      if (ref != NO_POS && read32 (src + ref) == x)
+        {
+          size_t len = LZ_MIN_MATCH;
+
+          while (pos + len < size && src[ref + len] == src[pos + len])
+            len++;
+          if (!put_sequence (&out, src + anchor, pos - anchor, pos - ref, len))
+            return 0;
+          pos += len;
+          anchor = pos;
+        }
+      else
+        pos++;
+    }
+
+  if (!put_sequence (&out, src + anchor, size - anchor, 0, 0))
+    return 0;
+  return out.p - (uint8_t *) dst;
+}
+
+/* Reads a length from SRC, which ends at END, starting from the
+   nibble value NIBBLE, into *LENGTH.  Returns false if the data
+   ends too soon. */
+static bool
+get_length (const uint8_t **src, const uint8_t *end, size_t nibble,
+            size_t *length)
+{
+  *length = nibble;
+  if (nibble == 15)
+    for (;;)
+      {
+        uint8_t byte;
+
+        if (*src >= end)
+          return false;
+        byte = *(*src)++;
+        *length += byte;
+        if (byte != 255)
+          break;
+      }
+  return true;
+}
+
+/* Decompresses the SIZE bytes of compressed data at SRC into
+   DST, which must end up holding exactly CAPACITY bytes.
+   Returns true if successful, false if the data is corrupt. */
+bool
+lz_decompress (const void *src_, size_t size, void *dst_, size_t capacity)
+{
+  const uint8_t *src = src_;
+  const uint8_t *end = src + size;
+  uint8_t *dst = dst_;
+  size_t pos = 0;
+
+  while (src < end)
+    {
+      uint8_t token = *src++;
+      size_t lit_cnt, match_len, distance;
+
+      if (!get_length (&src, end, token >> 4, &lit_cnt)
+          || lit_cnt > (size_t) (end - src) || lit_cnt > capacity - pos)
+        return false;
+      memcpy (dst + pos, src, lit_cnt);
+      src += lit_cnt;
+      pos += lit_cnt;
+      if (src == end)
+        break;
+
+      if (end - src < 2)
+        return false;
+      distance = src[0] | (src[1] << 8);
+      src += 2;
+      if (!get_length (&src, end, token & 15, &match_len))
+        return false;
+      match_len += LZ_MIN_MATCH;
+      if (distance == 0 || distance > pos || match_len > capacity - pos)
+        return false;
+
+      /* Copy a byte at a time, because the copy may overlap its
+         own output. */
+      for (; match_len > 0; match_len--, pos++)
+        dst[pos] = dst[pos - distance];
+    }
+
+  return pos == capacity;
+}
@@ -0,0 +1,34 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* LZ77-family data compression.
+
+   A fast, simple compressor in the style of LZ4, meant for
+   squeezing pages of memory rather than for a high ratio.  The
+   compressed data is a series of sequences, each a run of
+   literal bytes followed by a copy of earlier output.  Each
+   sequence starts with a token byte whose high nibble is the
+   number of literals and whose low nibble is the copy length
+   minus LZ_MIN_MATCH; a nibble of 15 means that more of the
+   length follows in bytes of 255 ending with one less than 255.
+   The literals come next, then the copy's distance back, as two
+   little-endian bytes, then any more of its length.  The last
+   sequence has literals only, and ends the data. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Shortest copy that is encoded as a copy. */
+#define LZ_MIN_MATCH 4
+
+/* Longest input accepted by lz_compress(). */
+#define LZ_MAX_INPUT 65535
+
+/* Bytes of scratch space needed by lz_compress(). */
+#define LZ_WORK_SIZE 1024
+
+size_t lz_compress (const void *src, size_t size, void *dst, size_t capacity,
+                    void *work);
+bool lz_decompress (const void *src, size_t size, void *dst, size_t capacity);
+
+#endif /* lib/kernel/lz.h */
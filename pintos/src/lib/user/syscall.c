@@ -61,6 +61,25 @@
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; int $0x30; "      \
+             "addl $20, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [arg1] "g" (ARG1),                             \
+                 [arg2] "g" (ARG2),                             \
+                 [arg3] "g" (ARG3)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
 void
 halt (void) 
 {
@@ -182,3 +201,59 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned position)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, position);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned position)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, position);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+copy_range (int in_fd, int out_fd, unsigned length)
+{
+  return syscall3 (SYS_COPY_RANGE, in_fd, out_fd, length);
+}
+
+unsigned
+ticks (void)
+{
+  return syscall0 (SYS_TICKS);
+}
+
+/* Unlike other system calls, this one returns a 64-bit value, in
+   edx:eax, so it can't use syscall0(). */
+long long
+clock_ns (void)
+{
+  long long retval;
+  asm volatile
+    ("pushl %[number]; int $0x30; addl $4, %%esp"
+       : "=A" (retval)
+       : [number] "i" (SYS_CLOCK_NS)
+       : "memory");
+  return retval;
+}
+
+bool
+block_stats (const char *role, struct block_stats *stats)
+{
+  return syscall2 (SYS_BLOCK_STATS, role, stats);
+}
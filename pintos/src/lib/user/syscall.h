@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <block-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -15,6 +16,16 @@ typedef int mapid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* One buffer in a readv() or writev() call. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    unsigned iov_len;           /* Buffer size in bytes. */
+  };
+
+/* Maximum number of buffers in a readv() or writev() call. */
+#define IOV_MAX 64
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -45,4 +56,14 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int pread (int fd, void *buffer, unsigned length, unsigned position);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned position);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_range (int in_fd, int out_fd, unsigned length);
+unsigned ticks (void);
+long long clock_ns (void);
+bool block_stats (const char *role, struct block_stats *);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,60 @@
+/* Checks that several threads can hold a reader-writer lock for
+   reading at the same time.  The main thread keeps the lock for
+   reading while it waits for three other readers to acquire it,
+   which would deadlock if readers excluded each other. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define READER_CNT 3
+
+static struct rwlock rwlock;
+static struct semaphore entered;
+static struct semaphore done;
+
+static thread_func reader_thread;
+
+void
+test_rwlock_readers (void) 
+{
+  int i;
+
+  rwlock_init (&rwlock);
+  sema_init (&entered, 0);
+  sema_init (&done, 0);
+
+  rwlock_acquire_read (&rwlock);
+  msg ("Main thread acquired lock for reading.");
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, reader_thread, NULL);
+    }
+
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&entered);
+  msg ("%d other readers hold the lock along with main thread.",
+       READER_CNT);
+
+  for (i = 0; i < READER_CNT; i++)
+    sema_up (&done);
+  rwlock_release_read (&rwlock);
+
+  /* Every reader must have released the lock for a writer to
+     get it. */
+  rwlock_acquire_write (&rwlock);
+  msg ("Main thread acquired lock for writing.");
+  rwlock_release_write (&rwlock);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  sema_up (&entered);
+  sema_down (&done);
+  rwlock_release_read (&rwlock);
+}
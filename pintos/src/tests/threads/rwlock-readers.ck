@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) Main thread acquired lock for reading.
+(rwlock-readers) 3 other readers hold the lock along with main thread.
+(rwlock-readers) Main thread acquired lock for writing.
+(rwlock-readers) end
+EOF
+pass;
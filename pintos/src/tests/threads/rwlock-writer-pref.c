@@ -0,0 +1,63 @@
+/* Checks that once a writer is waiting for a reader-writer lock,
+   new readers wait behind it instead of keeping it out.
+
+   The main thread holds the lock for reading.  A writer starts
+   waiting for it, and then a second reader arrives.  The second
+   reader must not get the lock, even though only readers hold
+   it, and must get it only after the writer is done. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static struct rwlock rwlock;
+static struct semaphore done;
+
+/* Threads that have acquired the lock, in order. */
+static char order[3];
+static int order_cnt;
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+
+void
+test_rwlock_writer_pref (void) 
+{
+  rwlock_init (&rwlock);
+  sema_init (&done, 0);
+
+  rwlock_acquire_read (&rwlock);
+  msg ("Main thread acquired lock for reading.");
+
+  thread_create ("writer", PRI_DEFAULT, writer_thread, NULL);
+  timer_sleep (10);
+  thread_create ("reader", PRI_DEFAULT, reader_thread, NULL);
+  timer_sleep (10);
+  msg ("%d threads got the lock while main thread held it.", order_cnt);
+
+  rwlock_release_read (&rwlock);
+  sema_down (&done);
+  sema_down (&done);
+  order[order_cnt] = '\0';
+  msg ("Threads got the lock in order \"%s\".", order);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  order[order_cnt++] = 'R';
+  rwlock_release_read (&rwlock);
+  sema_up (&done);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  order[order_cnt++] = 'W';
+  rwlock_release_write (&rwlock);
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-pref) begin
+(rwlock-writer-pref) Main thread acquired lock for reading.
+(rwlock-writer-pref) 0 threads got the lock while main thread held it.
+(rwlock-writer-pref) Threads got the lock in order "WR".
+(rwlock-writer-pref) end
+EOF
+pass;
@@ -0,0 +1,77 @@
+/* Checks that a thread holding a reader-writer lock for writing
+   keeps out readers and other writers, and that a writer waits
+   for a reader to release the lock. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static struct rwlock rwlock;
+static struct semaphore entered;
+static bool inside;
+
+static thread_func reader_thread;
+static thread_func writer_thread;
+
+static void check_waits (thread_func *, const char *who,
+                         const char *holder);
+
+void
+test_rwlock_writer (void) 
+{
+  rwlock_init (&rwlock);
+  sema_init (&entered, 0);
+
+  rwlock_acquire_write (&rwlock);
+  check_waits (reader_thread, "Reader", "main thread holds lock for writing");
+
+  rwlock_acquire_write (&rwlock);
+  check_waits (writer_thread, "Writer", "main thread holds lock for writing");
+
+  rwlock_acquire_read (&rwlock);
+  check_waits (writer_thread, "Writer", "main thread holds lock for reading");
+}
+
+/* Starts a thread running FUNCTION, which tries to acquire the
+   lock, while the main thread holds it as described by HOLDER.
+   Checks that the thread WHO gets the lock only after the main
+   thread releases it. */
+static void
+check_waits (thread_func *function, const char *who, const char *holder)
+{
+  bool writing = rwlock_held_for_write (&rwlock);
+
+  inside = false;
+  thread_create (who, PRI_DEFAULT, function, NULL);
+
+  /* Give the new thread plenty of time to run. */
+  timer_sleep (10);
+  msg ("%s %s while %s.", who, inside ? "got lock" : "waits", holder);
+
+  if (writing)
+    rwlock_release_write (&rwlock);
+  else
+    rwlock_release_read (&rwlock);
+  sema_down (&entered);
+  msg ("%s got lock after main thread released it.", who);
+}
+
+static void
+reader_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_read (&rwlock);
+  inside = true;
+  rwlock_release_read (&rwlock);
+  sema_up (&entered);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rwlock_acquire_write (&rwlock);
+  inside = true;
+  rwlock_release_write (&rwlock);
+  sema_up (&entered);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) Reader waits while main thread holds lock for writing.
+(rwlock-writer) Reader got lock after main thread released it.
+(rwlock-writer) Writer waits while main thread holds lock for writing.
+(rwlock-writer) Writer got lock after main thread released it.
+(rwlock-writer) Writer waits while main thread holds lock for reading.
+(rwlock-writer) Writer got lock after main thread released it.
+(rwlock-writer) end
+EOF
+pass;
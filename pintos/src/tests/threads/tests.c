@@ -29,6 +29,9 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-writer", test_rwlock_writer},
+    {"rwlock-writer-pref", test_rwlock_writer_pref},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
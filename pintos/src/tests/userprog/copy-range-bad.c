@@ -0,0 +1,31 @@
+/* Tries copy_range() from a file to itself, which must fail
+   with -1, and with a length too large for a file offset, which
+   must copy the whole file. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int in, out, copied;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  if (copy_range (in, in, 16) != -1)
+    fail ("copy_range() to the same fd did not return -1");
+  msg ("copy_range() to the same fd returned -1");
+
+  CHECK (create ("copy.txt", 0), "create \"copy.txt\"");
+  CHECK ((out = open ("copy.txt")) > 1, "open \"copy.txt\"");
+  copied = copy_range (in, out, 0xffffffff);
+  if (copied != (int) sizeof sample - 1)
+    fail ("copy_range() copied %d bytes instead of %zu",
+          copied, sizeof sample - 1);
+  msg ("copy_range() with huge length copied whole file");
+  close (in);
+  close (out);
+
+  check_file ("copy.txt", sample, sizeof sample - 1);
+}
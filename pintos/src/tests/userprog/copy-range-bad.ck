@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range-bad) begin
+(copy-range-bad) open "sample.txt"
+(copy-range-bad) copy_range() to the same fd returned -1
+(copy-range-bad) create "copy.txt"
+(copy-range-bad) open "copy.txt"
+(copy-range-bad) copy_range() with huge length copied whole file
+(copy-range-bad) open "copy.txt" for verification
+(copy-range-bad) verified contents of "copy.txt"
+(copy-range-bad) close "copy.txt"
+(copy-range-bad) end
+copy-range-bad: exit(0)
+EOF
+pass;
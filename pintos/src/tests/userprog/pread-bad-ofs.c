@@ -0,0 +1,36 @@
+/* Tries pread() and pwrite() at offsets that a file offset can't
+   hold, which must fail with -1 without killing the process or
+   touching the file. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const unsigned bad_ofs[] = {0x80000000, 0xffffff9c, 0xffffffff};
+  char buf[16];
+  int handle;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (i = 0; i < sizeof bad_ofs / sizeof *bad_ofs; i++)
+    {
+      if (pread (handle, buf, sizeof buf, bad_ofs[i]) != -1)
+        fail ("pread() at offset %#x did not return -1", bad_ofs[i]);
+      if (pwrite (handle, buf, sizeof buf, bad_ofs[i]) != -1)
+        fail ("pwrite() at offset %#x did not return -1", bad_ofs[i]);
+    }
+  msg ("pread() and pwrite() past largest offset returned -1");
+
+  if (pread (handle, buf, sizeof buf, 0x7ffffff8) != -1)
+    fail ("pread() ending past largest offset did not return -1");
+  if (pwrite (handle, buf, sizeof buf, 0x7ffffff8) != -1)
+    fail ("pwrite() ending past largest offset did not return -1");
+  msg ("pread() and pwrite() ending past largest offset returned -1");
+  close (handle);
+
+  check_file ("sample.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,33 @@
+/* Reads with pread() up to and past the end of a file.  A read
+   that starts at or past the end returns 0, and one that spans
+   the end returns only the bytes before it. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[64];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  byte_cnt = pread (handle, buf, sizeof buf, sizeof sample - 11);
+  if (byte_cnt != 10)
+    fail ("pread() spanning end of file returned %d instead of 10",
+          byte_cnt);
+  compare_bytes (buf, sample + sizeof sample - 11, 10, sizeof sample - 11,
+                 "sample.txt");
+  msg ("pread() spanning end of file read 10 bytes");
+
+  byte_cnt = pread (handle, buf, sizeof buf, sizeof sample - 1);
+  if (byte_cnt != 0)
+    fail ("pread() at end of file returned %d instead of 0", byte_cnt);
+  byte_cnt = pread (handle, buf, sizeof buf, 100000);
+  if (byte_cnt != 0)
+    fail ("pread() past end of file returned %d instead of 0", byte_cnt);
+  msg ("pread() at and past end of file read 0 bytes");
+}
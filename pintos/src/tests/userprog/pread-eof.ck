@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-eof) begin
+(pread-eof) open "sample.txt"
+(pread-eof) pread() spanning end of file read 10 bytes
+(pread-eof) pread() at and past end of file read 0 bytes
+(pread-eof) end
+pread-eof: exit(0)
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Reads parts of a file at given offsets with pread(), which
+   must not use or change the file position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+check_pread (int handle, size_t size, unsigned ofs)
+{
+  char buf[64];
+  int byte_cnt;
+
+  byte_cnt = pread (handle, buf, size, ofs);
+  if (byte_cnt != (int) size)
+    fail ("pread() at offset %u returned %d instead of %zu",
+          ofs, byte_cnt, size);
+  compare_bytes (buf, sample + ofs, size, ofs, "sample.txt");
+}
+
+void
+test_main (void) 
+{
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  seek (handle, 17);
+  check_pread (handle, 20, 100);
+  check_pread (handle, 64, 0);
+  check_pread (handle, 1, sizeof sample - 2);
+  msg ("pread() returned the expected data");
+  if (tell (handle) != 17)
+    fail ("pread() moved the file position to %u", tell (handle));
+  msg ("file position is unchanged");
+}
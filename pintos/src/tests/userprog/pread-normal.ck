@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-normal) begin
+(pread-normal) open "sample.txt"
+(pread-normal) pread() returned the expected data
+(pread-normal) file position is unchanged
+(pread-normal) end
+pread-normal: exit(0)
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Writes a file out of order with pwrite(), including past its
+   end, which must not use or change the file position, and then
+   checks its contents. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Where to put the sample, past the end of the empty file. */
+#define OFS 100
+
+void
+test_main (void) 
+{
+  static char expected[OFS + sizeof sample - 1];
+  size_t half = (sizeof sample - 1) / 2;
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  /* Second half first, so that the file grows with a gap. */
+  byte_cnt = pwrite (handle, sample + half, sizeof sample - 1 - half,
+                     OFS + half);
+  if (byte_cnt != (int) (sizeof sample - 1 - half))
+    fail ("pwrite() returned %d instead of %zu",
+          byte_cnt, sizeof sample - 1 - half);
+  byte_cnt = pwrite (handle, sample, half, OFS);
+  if (byte_cnt != (int) half)
+    fail ("pwrite() returned %d instead of %zu", byte_cnt, half);
+  msg ("pwrite() wrote both halves");
+  if (tell (handle) != 0)
+    fail ("pwrite() moved the file position to %u", tell (handle));
+  msg ("file position is unchanged");
+  close (handle);
+
+  memcpy (expected + OFS, sample, sizeof sample - 1);
+  check_file ("test.txt", expected, sizeof expected);
+}
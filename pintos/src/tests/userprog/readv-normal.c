@@ -0,0 +1,40 @@
+/* Reads a file into several buffers of different sizes with
+   readv(), which must fill them in order and advance the file
+   position past everything read. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char a[1], b[100], c[sizeof sample];
+  struct iovec iov[3];
+  int handle, byte_cnt;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof a;
+  iov[1].iov_base = b;
+  iov[1].iov_len = sizeof b;
+  iov[2].iov_base = c;
+  iov[2].iov_len = sizeof c;
+  byte_cnt = readv (handle, iov, 3);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("readv() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  compare_bytes (a, sample, sizeof a, 0, "sample.txt");
+  compare_bytes (b, sample + sizeof a, sizeof b, sizeof a, "sample.txt");
+  compare_bytes (c, sample + sizeof a + sizeof b,
+                 sizeof sample - 1 - sizeof a - sizeof b,
+                 sizeof a + sizeof b, "sample.txt");
+  msg ("readv() filled the buffers in order");
+
+  if (tell (handle) != sizeof sample - 1)
+    fail ("file position is %u instead of %zu",
+          tell (handle), sizeof sample - 1);
+  msg ("file position is at end of file");
+}
@@ -0,0 +1,33 @@
+/* Writes a file from several buffers with writev(), including
+   an empty one, and checks that they were written in order. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov[4];
+  int handle, byte_cnt;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = sample + 1;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 1;
+  iov[2].iov_len = 200;
+  iov[3].iov_base = sample + 201;
+  iov[3].iov_len = sizeof sample - 1 - 201;
+  byte_cnt = writev (handle, iov, 4);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("writev() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  msg ("writev() wrote every buffer");
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,40 @@
+/* Checks that the stack is extended when the first access to a
+   stack location occurs inside pread() or readv(), just as it is
+   for read() in pt-grow-stk-sc. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int handle;
+  int slen = strlen (sample);
+  char buf2[65536];
+  struct iovec iov[2];
+
+  CHECK (create ("sample.txt", slen), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (write (handle, sample, slen) == slen, "write \"sample.txt\"");
+
+  /* Each buffer is in a different page that has not been touched
+     yet. */
+  CHECK (pread (handle, buf2 + 32768, slen, 0) == slen,
+         "pread \"sample.txt\"");
+  CHECK (!memcmp (sample, buf2 + 32768, slen),
+         "compare written data against pread data");
+
+  seek (handle, 0);
+  iov[0].iov_base = buf2 + 16384;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = buf2 + 8192;
+  iov[1].iov_len = slen - 10;
+  CHECK (readv (handle, iov, 2) == slen, "readv \"sample.txt\"");
+  CHECK (!memcmp (sample, buf2 + 16384, 10)
+         && !memcmp (sample + 10, buf2 + 8192, slen - 10),
+         "compare written data against readv data");
+  close (handle);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pt-grow-stk-pread) begin
+(pt-grow-stk-pread) create "sample.txt"
+(pt-grow-stk-pread) open "sample.txt"
+(pt-grow-stk-pread) write "sample.txt"
+(pt-grow-stk-pread) pread "sample.txt"
+(pt-grow-stk-pread) compare written data against pread data
+(pt-grow-stk-pread) readv "sample.txt"
+(pt-grow-stk-pread) compare written data against readv data
+(pt-grow-stk-pread) end
+EOF
+pass;
@@ -35,7 +35,9 @@
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "devices/block-sched.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -54,6 +56,14 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -filesys-sched, -swap-sched: Names of I/O schedulers to use
+   for the file system and swap devices, overriding the
+   default. */
+static const char *filesys_sched_name;
+#ifdef VM
+static const char *swap_sched_name;
+#endif
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
@@ -69,7 +79,8 @@ static void usage (void);
 
 #ifdef FILESYS
 static void locate_block_devices (void);
-static void locate_block_device (enum block_type, const char *name);
+static void locate_block_device (enum block_type, const char *name,
+                                 const char *sched_name);
 #endif
 
 int main (void) NO_RETURN;
@@ -125,6 +136,7 @@ main (void)
 
 #ifdef FILESYS
   /* Initialize file system. */
+  ramdisk_init ();
   ide_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
@@ -255,15 +267,23 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-filesys-sched"))
+        filesys_sched_name = value;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_configure (value);
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-swap-sched"))
+        swap_sched_name = value;
 #endif
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-timer-slack"))
+        timer_set_slack (atoi (value));
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -381,12 +401,18 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -filesys-sched=S   Schedule file system I/O with S: fifo,\n"
+          "                     clook (the default), or deadline.\n"
+          "  -ramdisk=ROLE:KB   Use a KB-kB RAM disk for ROLE: filesys,\n"
+          "                     scratch, or swap.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -swap-sched=S      Schedule swap I/O with S.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -timer-slack=N     Let wakeups be up to N ticks late when idle.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -399,19 +425,21 @@ usage (void)
 static void
 locate_block_devices (void)
 {
-  locate_block_device (BLOCK_FILESYS, filesys_bdev_name);
-  locate_block_device (BLOCK_SCRATCH, scratch_bdev_name);
+  locate_block_device (BLOCK_FILESYS, filesys_bdev_name, filesys_sched_name);
+  locate_block_device (BLOCK_SCRATCH, scratch_bdev_name, NULL);
 #ifdef VM
-  locate_block_device (BLOCK_SWAP, swap_bdev_name);
+  locate_block_device (BLOCK_SWAP, swap_bdev_name, swap_sched_name);
 #endif
 }
 
 /* Figures out what block device to use for the given ROLE: the
    block device with the given NAME, if NAME is non-null,
    otherwise the first block device in probe order of type
-   ROLE. */
+   ROLE.  If SCHED_NAME is non-null, the device's requests are
+   ordered by the I/O scheduler with that name. */
 static void
-locate_block_device (enum block_type role, const char *name)
+locate_block_device (enum block_type role, const char *name,
+                     const char *sched_name)
 {
   struct block *block = NULL;
 
@@ -432,6 +460,14 @@ locate_block_device (enum block_type role, const char *name)
     {
       printf ("%s: using %s\n", block_type_name (role), block_name (block));
       block_set_role (role, block);
+
+      if (sched_name != NULL)
+        {
+          const struct block_scheduler *sched = block_sched_find (sched_name);
+          if (sched == NULL)
+            PANIC ("No such I/O scheduler \"%s\"", sched_name);
+          block_set_scheduler (block, sched);
+        }
     }
 }
 #endif
@@ -214,6 +214,29 @@ intr_context (void)
   return in_external_intr;
 }
 
+/* Returns true if external interrupt VEC_NO has been raised but
+   not yet delivered, which can happen only while interrupts are
+   off. */
+bool
+intr_is_pending (uint8_t vec_no)
+{
+  int irq = vec_no - 0x20;
+
+  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+
+  /* OCW3: select the interrupt request register for reading. */
+  if (irq < 8)
+    {
+      outb (PIC0_CTRL, 0x0a);
+      return (inb (PIC0_CTRL) & (1 << irq)) != 0;
+    }
+  else
+    {
+      outb (PIC1_CTRL, 0x0a);
+      return (inb (PIC1_CTRL) & (1 << (irq - 8))) != 0;
+    }
+}
+
 /* During processing of an external interrupt, directs the
    interrupt handler to yield to a new process just before
    returning from the interrupt.  May not be called at any other
@@ -336,3 +336,127 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RW as a readers-writer lock.  Any number of
+   threads may hold RW for reading at once, but a thread holding
+   it for writing excludes all others.
+
+   Writers are preferred: once a writer is waiting, newly
+   arriving readers wait behind it, so a steady stream of
+   readers cannot starve writers.  Readers cannot be starved
+   either, because when a writer releases RW every reader that
+   was already waiting is let in before the next writer, even if
+   more writers are queued. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->can_read);
+  cond_init (&rw->can_write);
+  rw->writer = NULL;
+  rw->readers = 0;
+  rw->waiting_readers = 0;
+  rw->waiting_writers = 0;
+  rw->admitted_readers = 0;
+  rw->read_gen = 0;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it
+   and no writer is waiting for it, unless this reader has been
+   let in by a releasing writer.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  unsigned gen;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  gen = rw->read_gen;
+  if (rw->writer != NULL || rw->waiting_writers > 0)
+    {
+      rw->waiting_readers++;
+      while (rw->writer != NULL
+             || (rw->waiting_writers > 0 && gen == rw->read_gen))
+        cond_wait (&rw->can_read, &rw->lock);
+      rw->waiting_readers--;
+      if (gen != rw->read_gen)
+        rw->admitted_readers--;
+    }
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for
+   reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0 && rw->waiting_writers > 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it and every reader let in by the last writer has entered.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (rw->writer != NULL || rw->readers > 0 || rw->admitted_readers > 0)
+    cond_wait (&rw->can_write, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Lets in all readers waiting at this point, if any, otherwise
+   the next waiting writer. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer == thread_current ());
+  rw->writer = NULL;
+  if (rw->waiting_readers > 0)
+    {
+      rw->admitted_readers = rw->waiting_readers;
+      rw->read_gen++;
+      cond_broadcast (&rw->can_read, &rw->lock);
+    }
+  else if (rw->waiting_writers > 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
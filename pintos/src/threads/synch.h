@@ -43,6 +43,27 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition can_read;  /* Signaled when readers may enter. */
+    struct condition can_write; /* Signaled when a writer may enter. */
+    struct thread *writer;      /* Thread holding lock for writing. */
+    int readers;                /* Number of threads holding lock for reading. */
+    int waiting_readers;        /* Number of readers waiting. */
+    int waiting_writers;        /* Number of writers waiting. */
+    int admitted_readers;       /* Waiting readers let in ahead of writers. */
+    unsigned read_gen;          /* Incremented each time readers are let in. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
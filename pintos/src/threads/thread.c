@@ -4,6 +4,7 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
@@ -140,6 +141,16 @@ thread_tick (void)
     intr_yield_on_return ();
 }
 
+/* Accounts for CNT timer ticks that passed while the CPU was
+   idle, without a timer interrupt for each of them.  Interrupts
+   must be off. */
+void
+thread_tick_idle (int64_t cnt)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  idle_ticks += cnt;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void)
@@ -401,10 +412,17 @@ idle (void *idle_started_ UNUSED)
 
   for (;;)
     {
-      /* Let someone else run. */
+      /* Let someone else run.  If we were woken by some interrupt
+         other than the timer's, first put the timer back to
+         ticking regularly for them. */
       intr_disable ();
+      timer_idle_exit ();
       thread_block ();
 
+      /* Nobody else can run before some interrupt, so let the
+         timer skip the ticks until the next thread wakes up. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -470,9 +488,11 @@ init_thread (struct thread *t, const char *name, int priority)
   t->magic = THREAD_MAGIC;
   list_push_back (&all_list, &t->allelem);
 
-  // initialize file list
-  list_init (&t->open_files);
-  t->next_fd=2;
+  // initialize file descriptor table; it is allocated on first open
+  t->fd_table = NULL;
+  t->fd_table_size = 0;
+  t->fd_lowest_free = 2;
+  t->log_depth = 0;
 
   // initialize child infrastructure
   list_init(&t->children);
@@ -86,12 +86,13 @@ struct child_status {
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member has a triple purpose.  It can be an element
+   in the run queue (thread.c), in a semaphore wait list
+   (synch.c), or in the list of sleeping threads (timer.c).  It
+   can be used these ways only because they are mutually
+   exclusive: only a thread in the ready state is on the run
+   queue, whereas only a thread in the blocked state is on a
+   semaphore wait list or sleeping, and it can't be both. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -101,8 +102,10 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
-    struct list open_files;
-    int next_fd;
+    struct file **fd_table;             /* Open files, indexed by fd. */
+    int fd_table_size;                  /* Number of slots in fd_table. */
+    int fd_lowest_free;                 /* No free fd below this one. */
+    int log_depth;                      /* Nesting of file system log ops. */
     int child_load;
     struct lock child_lock;
     struct condition child_condition;
@@ -112,9 +115,12 @@ struct thread
     struct thread *parent;              /* The parent thread. */
     struct list files;                  /* File associated with the thread. */
     struct file *exec;                  /* File the thread is executing. */
-    /* Shared between thread.c and synch.c. */
+    /* Shared between thread.c, synch.c, and timer.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* When to wake from timer_sleep(). */
+
     /* Memory Maped Files table */
     mapid_t mapid_allocator;
     struct hash mmfiles;
@@ -123,6 +129,9 @@ struct thread
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+
+    /* Owned by userprog/syscall.c. */
+    void *syscall_esp;                  /* User esp at system call. */
 #endif
 
     struct hash suppl_page_table;//supplemental page table
@@ -139,6 +148,7 @@ void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_tick_idle (int64_t cnt);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
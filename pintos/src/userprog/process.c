@@ -291,9 +291,6 @@ process_exit (void)
     cond_signal(&parent_thread->child_condition, &parent_thread->child_lock);
     lock_release(&parent_thread->child_lock);
   }
-  if (!list_empty (&cur->files))
-    close_all_files (cur);
-
   if (cur->exec != NULL)
     {
       file_allow_write (cur->exec);
@@ -845,22 +842,18 @@ mmfiles_free_entry (struct mmfile* mmf_ptr)
           && pagedir_is_dirty (t->pagedir, spte_ptr->user_vaddr))
       {
         /* write back to disk */
-        lock_acquire (&filesys_lock);
         file_seek (spte_ptr->data.mmf_page.file,
                    spte_ptr->data.mmf_page.offset);
         file_write (spte_ptr->data.mmf_page.file,
                     spte_ptr->user_vaddr,
                     spte_ptr->data.mmf_page.read_bytes);
-        lock_release (&filesys_lock);
       }
       free (spte_ptr);
     }
     offset += PGSIZE;
   }
 
-  lock_acquire (&filesys_lock);
   file_close (mmf_ptr->file);
-  lock_release (&filesys_lock);
 
   free (mmf_ptr);
 }
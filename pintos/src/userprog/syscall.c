@@ -1,5 +1,6 @@
 #include "devices/shutdown.h"
 #include "devices/input.h"
+#include "devices/timer.h"
 #include "userprog/syscall.h"
 #include "userprog/process.h"
 #include "filesys/filesys.h"
@@ -30,22 +31,22 @@
 static void syscall_handler (struct intr_frame *);
 bool is_valid_ptr(const void *user_ptr);
 static bool is_valid_uvaddr(const void *);
-void close_all_files (struct thread *t);
-struct lock filesys_lock;
-struct file_descriptor{
-  int fd_num;
-  tid_t owner;
-  struct file *file_struct;
-  struct list_elem elem;
-};
-struct file_descriptor * retrieve_file(int fd);
-
-static uint32_t *esp;
+static void load_user_buffer (const void *buffer, unsigned size);
+static void load_user_string (const char *str);
+static bool is_valid_range (unsigned position, unsigned size);
+static const struct iovec *get_user_iov (const struct iovec *iov, int iovcnt);
+struct file *retrieve_file (int fd);
+static int alloc_fd (struct file *);
+
+/* Initial and maximum number of slots in a process's file
+   descriptor table.  Slots 0 and 1 are the console and are never
+   used. */
+#define FD_TABLE_MIN 16
+#define FD_TABLE_MAX 1024
 
 void
 syscall_init (void)
 {
-  lock_init(&filesys_lock);
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -57,6 +58,7 @@ syscall_handler (struct intr_frame *f)
 
   // The system call number is in the 32-bit word at the caller's stack pointer.
   esp = f->esp;
+  thread_current ()->syscall_esp = f->esp;
   //printf("SYSCALL: esp is %d\n", *esp);
   if(!is_valid_ptr(esp)){
     //printf("SYSCALL: esp invalid pointer\n");
@@ -101,9 +103,7 @@ syscall_handler (struct intr_frame *f)
 
       //printf("SYSCALL: SYS_CREATE: filename: %s\n", *(esp+4));
 
-      lock_acquire(&filesys_lock);
       f->eax = filesys_create((const char*)*(esp+4), (off_t)*(esp+5));
-      lock_release(&filesys_lock);
 
       break;
     }
@@ -117,9 +117,7 @@ syscall_handler (struct intr_frame *f)
 
       //printf("SYSCALL: SYS_REMOVE: filename: %s\n", *(esp+1));
 
-      lock_acquire(&filesys_lock);
       f->eax = filesys_remove((const char *)*(esp+1));
-      lock_release(&filesys_lock);
       break;
     }
   case SYS_WRITE:
@@ -253,6 +251,75 @@ syscall_handler (struct intr_frame *f)
   case SYS_MUNMAP:
     munmap (*(esp + 1));
     break;
+  case SYS_PREAD:
+  case SYS_PWRITE:
+    {
+      /* syscall4: fd, buffer, size, position. */
+      if (!is_valid_ptr ((const void *) (esp + 1))
+          || !is_valid_ptr ((const void *) (esp + 4)))
+        sys_exit (-1);
+
+      if (*esp == SYS_PREAD)
+        f->eax = sys_pread ((int) *(esp + 1), (void *) *(esp + 2),
+                            (unsigned) *(esp + 3), (unsigned) *(esp + 4));
+      else
+        f->eax = sys_pwrite ((int) *(esp + 1), (const void *) *(esp + 2),
+                             (unsigned) *(esp + 3), (unsigned) *(esp + 4));
+      break;
+    }
+  case SYS_READV:
+  case SYS_WRITEV:
+    {
+      /* syscall3: fd, iov, iovcnt. */
+      if (!is_valid_ptr ((const void *) (esp + 1))
+          || !is_valid_ptr ((const void *) (esp + 3)))
+        sys_exit (-1);
+
+      if (*esp == SYS_READV)
+        f->eax = sys_readv ((int) *(esp + 1), (const struct iovec *) *(esp + 2),
+                            (int) *(esp + 3));
+      else
+        f->eax = sys_writev ((int) *(esp + 1),
+                             (const struct iovec *) *(esp + 2),
+                             (int) *(esp + 3));
+      break;
+    }
+  case SYS_COPY_RANGE:
+    {
+      /* syscall3: in_fd, out_fd, length. */
+      if (!is_valid_ptr ((const void *) (esp + 1))
+          || !is_valid_ptr ((const void *) (esp + 3)))
+        sys_exit (-1);
+
+      f->eax = sys_copy_range ((int) *(esp + 1), (int) *(esp + 2),
+                               (unsigned) *(esp + 3));
+      break;
+    }
+  case SYS_TICKS:
+    f->eax = timer_ticks ();
+    break;
+  case SYS_CLOCK_NS:
+    {
+      /* The 64-bit result is returned in edx:eax. */
+      uint64_t ns = timer_ns ();
+      f->eax = ns;
+      f->edx = ns >> 32;
+      break;
+    }
+  case SYS_BLOCK_STATS:
+    {
+      /* syscall2: role, stats. */
+      if (!is_valid_ptr ((const void *) (esp + 1))
+          || !is_valid_ptr ((const void *) (esp + 2)))
+        sys_exit (-1);
+      load_user_string ((const char *) *(esp + 1));
+      load_user_buffer ((const void *) *(esp + 2),
+                        sizeof (struct block_stats));
+
+      f->eax = sys_block_stats ((const char *) *(esp + 1),
+                                (struct block_stats *) *(esp + 2));
+      break;
+    }
 
   /* unhandled case */
   default:
@@ -266,57 +333,40 @@ syscall_handler (struct intr_frame *f)
 
 int sys_filesize(int fd_num)
 {
-  struct file_descriptor * file_desc;
+  struct file *file;
   int returnval = -1;
 
   //printf("sys_filesize: retrieving file descriptor: %d\n", fd_num);
 
-  // using the file filesystem => acquire lock
-  lock_acquire(&filesys_lock);
-
-  file_desc = retrieve_file(fd_num);
+  file = retrieve_file(fd_num);
 
-  if (file_desc != NULL)
-  {
-    //printf("sys_filesize: retrieved file descriptor: %d\n", file_desc->fd_num);
-    returnval = file_length(file_desc->file_struct);
-  }
-  lock_release(&filesys_lock);
+  if (file != NULL)
+    returnval = file_length(file);
   return returnval;
 }
 
 /* Opens the file called file. Returns a nonnegative integer handle called a "file descriptor" or -1 if the file could
- * not be opened. The file descriptor will be the integer location of the file in the current thread's list of files
+ * not be opened. The file descriptor is the lowest free slot in the current thread's file descriptor table
  * */
 int sys_open(char * file_name)
 {
-  // obtain lock for filesystem since we are about to open the file
-  lock_acquire(&filesys_lock);
-
-  // open the file
+  // open the file; the file system does its own locking
   struct file * new_file_struct = filesys_open(file_name);
 
   // file will be null if file not found in file system
   if (new_file_struct==NULL){
     // nothing to do here open fails, return -1
     //printf("sys_open: file not found in filesystem \n");
-    lock_release(&filesys_lock);
     return -1;
   }
-  // else add file to current threads list of open files
   // from pintos notes section 3.3.4 System calls: when a single file is opened more than once, whether by a single
   // process or different processes each open returns a new file descriptor. Different file descriptors for a single
-  // file are closed independently in seperate calls to close and they do not share a file position. We should make a
-  // list of files so if a single file is opened more than once we can close it without conflicts.
-  struct file_descriptor * new_thread_file = malloc(sizeof(struct file_descriptor));
-  new_thread_file->file_struct = new_file_struct;
-  new_thread_file->fd_num = thread_current()->next_fd;
-  new_thread_file->owner = thread_current()->tid;
-  thread_current()->next_fd++;
-  list_push_back(&thread_current()->open_files, &new_thread_file->elem);
-  //printf("sys_open: file found in filesystem. new file_descriptor number: %d \n", new_thread_file->fd_num);
-  lock_release(&filesys_lock);
-  return new_thread_file->fd_num;
+  // file are closed independently in seperate calls to close and they do not share a file position. Each open
+  // therefore gets its own struct file in its own slot of the descriptor table.
+  int fd = alloc_fd(new_file_struct);
+  if (fd < 0)
+    file_close(new_file_struct);
+  return fd;
 }
 
 int sys_exec (const char *cmdline){
@@ -333,25 +383,17 @@ int sys_exec (const char *cmdline){
 
   //printf("SYSCALL: sys_exec: file_name: %s \n", file_name);
 
-  // it is not safe to call into the file system code provided in "filesys" directory from multiple threads at once
-  // your system call implementation must treat the file system code as a critical section
-  // Don't forget the process_execute() also accesses files.
-  // => Obtain lock for file system
-  lock_acquire(&filesys_lock);
-
   // try and open file name
   f = filesys_open(file_name);
 
   // f will be null if file not found in file system
   if (f == NULL){
-    // nothing to do here exec fails, release lock and return -1
+    // nothing to do here exec fails, return -1
     //printf("SYSCALL: sys_exec: filesys_open failed\n");
-    lock_release(&filesys_lock);
     return (pid_t)-1;
   } else {
     // file exists, we can close file and call our implemented process_execute() to run the executable
     file_close(f);
-    lock_release(&filesys_lock);
 
     // wait for child process to load successfully, otherwise return -1
     thread_current()->child_load = 0;
@@ -438,7 +480,7 @@ bool is_valid_ptr(const void *user_ptr)
 
 int sys_write(int fd, const void *buffer, unsigned size) {
   //printf("WRITE: fd = %d, size = %d\n", fd, size);
-  struct file_descriptor *fd_struct;
+  struct file *file;
   int bytes_written = 0;
   unsigned buffer_size = size;
   void *buffer_tmp = buffer;
@@ -462,7 +504,6 @@ int sys_write(int fd, const void *buffer, unsigned size) {
     }
   }
 
-  lock_acquire(&filesys_lock);
   if(fd == STDIN_FILENO){
     bytes_written = -1;
   }
@@ -471,56 +512,21 @@ int sys_write(int fd, const void *buffer, unsigned size) {
     bytes_written = size;
   } else
   {
-    fd_struct = retrieve_file(fd);
-    if(fd_struct != NULL) {
-      bytes_written = file_write(fd_struct->file_struct, buffer, size);
+    file = retrieve_file(fd);
+    if(file != NULL) {
+      bytes_written = file_write(file, buffer, size);
     }
   }
 
-  lock_release(&filesys_lock);
   return bytes_written;
 }
 
 int sys_read(int fd, const void *buffer, unsigned size)
 {
-  struct file_descriptor *fd_struct;
+  struct file *file;
   int bytes_written = 0;
-  struct thread *t = thread_current();
-
-  unsigned buffer_size = size;
-  void * buffer_tmp = buffer;
-
-  while(buffer_tmp != NULL)
-  {
-    if(!is_valid_uvaddr(buffer_tmp))
-      exit(-1);
-
-    if(pagedir_get_page(t->pagedir, buffer_tmp) == NULL)
-    {
-      struct sup_page_entry *spte;
-      spte = get_spe(&t->suppl_page_table, pg_round_down(buffer_tmp));
-      if(spte != NULL & !spte->loaded)
-        load_page(spte);
-      else if(spte == NULL && buffer_tmp >= (esp - 32))
-        grow_stack(buffer_tmp);
-      else
-        exit(-1);
-    }
-
-    if(buffer_size == 0)
-      buffer_tmp = NULL;
-    else if(buffer_size > PGSIZE)
-    {
-      buffer_tmp += PGSIZE;
-      buffer_size -= PGSIZE;
-    } else
-    {
-      buffer_tmp = buffer + size - 1;
-      buffer_size = 0;
-    }
-  }
 
-  lock_acquire(&filesys_lock);
+  load_user_buffer (buffer, size);
 
   if(fd == STDOUT_FILENO) {
     bytes_written = -1;
@@ -537,133 +543,352 @@ int sys_read(int fd, const void *buffer, unsigned size)
     }
     *buf = 0;
     bytes_written = size - counter;
-//    lock_release(&filesys_lock);
 //    return (size - counter);
   }
   else {
-    fd_struct = retrieve_file(fd);
-    if(fd_struct != NULL)
-      bytes_written = file_read(fd_struct->file_struct, buffer, size);
+    file = retrieve_file(fd);
+    if(file != NULL)
+      bytes_written = file_read(file, buffer, size);
   }
 
-  lock_release(&filesys_lock);
   return bytes_written;
 }
 
 void sys_seek(int fd, unsigned position)
 {
-  struct file_descriptor *fd_struct;
-  lock_acquire(&filesys_lock);
-  fd_struct = retrieve_file(fd);
-  if(fd_struct != NULL)
-    file_seek(fd_struct->file_struct, position);
-  lock_release(&filesys_lock);
+  struct file *file;
+  file = retrieve_file(fd);
+  if(file != NULL)
+    file_seek(file, position);
   return;
 }
 
 unsigned sys_tell(int fd)
 {
-  struct file_descriptor *fd_struct;
+  struct file *file;
   int bytes = 0;
-  lock_acquire(&filesys_lock);
-  fd_struct = retrieve_file(fd);
-  if(fd_struct != NULL)
-    bytes = file_tell(fd_struct->file_struct);
-  lock_release(&filesys_lock);
+  file = retrieve_file(fd);
+  if(file != NULL)
+    bytes = file_tell(file);
   return bytes;
 }
 
 void sys_close(int fd)
 {
-  struct file_descriptor *fd_struct;
-  lock_acquire(&filesys_lock);
-  fd_struct = retrieve_file(fd);
-  if(fd_struct != NULL && fd_struct->owner == thread_current()->tid)
+  struct file *file;
+  file = retrieve_file(fd);
+  if(file != NULL)
     close_extra_files(fd);
-  lock_release(&filesys_lock);
 }
 
-struct file_descriptor *
-retrieve_file(int fd){
-  struct list_elem *list_element;
-  struct file_descriptor *fd_struct;
-  for(list_element = list_head(&thread_current()->open_files); list_element != list_tail(&thread_current()->open_files);
-  list_element = list_next(list_element)){
-    fd_struct = list_entry (list_element, struct file_descriptor, elem);
-    if (fd_struct->fd_num == fd)
-      return fd_struct;
-  }
-  //This is done for the tail
-  fd_struct = list_entry (list_element, struct file_descriptor, elem);
-  if (fd_struct->fd_num == fd)
-    return fd_struct;
+/* Reads SIZE bytes from file FD into BUFFER, starting at byte
+   POSITION in the file.  Unlike sys_read(), does not use or
+   change FD's current position, so a random-access reader does
+   not need a separate seek for every read.  Returns the number
+   of bytes read, or -1 if FD is not an open file or the bytes
+   are not all within the largest possible file offset. */
+int
+sys_pread (int fd, void *buffer, unsigned size, unsigned position)
+{
+  struct file *file;
 
-  return NULL;
+  load_user_buffer (buffer, size);
+  file = retrieve_file (fd);
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO || file == NULL
+      || !is_valid_range (position, size))
+    return -1;
+  return file_read_at (file, buffer, size, position);
 }
 
-void close_extra_files(int fd_num)
+/* Writes SIZE bytes from BUFFER to file FD, starting at byte
+   POSITION in the file, without using or changing FD's current
+   position.  Returns the number of bytes written, or -1 if FD is
+   not an open file or the bytes are not all within the largest
+   possible file offset. */
+int
+sys_pwrite (int fd, const void *buffer, unsigned size, unsigned position)
 {
-  struct list_elem *elem;
-  struct list_elem *temp;
-  struct file_descriptor *file_desc;
+  struct file *file;
 
-  elem = list_head (&(thread_current()->open_files));
-  while ((elem = list_next (elem)) != list_tail (&(thread_current()
-      ->open_files)))
-  {
-    temp = list_prev(elem);
-    file_desc = list_entry(elem, struct file_descriptor, elem);
-    if (file_desc->fd_num == fd_num)
+  load_user_buffer (buffer, size);
+  file = retrieve_file (fd);
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO || file == NULL
+      || !is_valid_range (position, size))
+    return -1;
+  return file_write_at (file, buffer, size, position);
+}
+
+/* Returns true if the SIZE bytes starting at POSITION can all be
+   addressed with an off_t. */
+static bool
+is_valid_range (unsigned position, unsigned size)
+{
+  return position <= INT32_MAX && size <= INT32_MAX - position;
+}
+
+/* Reads from file FD at its current position into the IOVCNT
+   buffers described by IOV, filling each one in turn, and
+   advances the position past the bytes read.  Stops early at end
+   of file.  Returns the total number of bytes read, or -1 if FD
+   is not an open file. */
+int
+sys_readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct file *file;
+  int total = 0;
+  int i;
+
+  iov = get_user_iov (iov, iovcnt);
+  file = retrieve_file (fd);
+  if (fd == STDIN_FILENO || fd == STDOUT_FILENO || file == NULL)
+    return -1;
+
+  for (i = 0; i < iovcnt; i++)
     {
-      list_remove(elem);
-      file_close(file_desc->file_struct);
-      free(file_desc);
-      return;
+      off_t bytes_read = file_read (file,
+                                    iov[i].iov_base, iov[i].iov_len);
+      total += bytes_read;
+      if (bytes_read < (off_t) iov[i].iov_len)
+        break;
     }
-    elem = temp;
-  }
-  return;
+  return total;
 }
 
-void
-close_thread_files(tid_t tid)
+/* Writes the IOVCNT buffers described by IOV, in order, to file
+   FD at its current position, or to the console if FD is
+   STDOUT_FILENO.  Returns the total number of bytes written, or
+   -1 if FD is not an open file. */
+int
+sys_writev (int fd, const struct iovec *iov, int iovcnt)
 {
-  struct list_elem *elem;
-  struct list_elem *temp;
-  struct file_descriptor *file_desc;
+  struct file *file = NULL;
+  int total = 0;
+  int i;
+
+  iov = get_user_iov (iov, iovcnt);
+  if (fd != STDOUT_FILENO)
+    {
+      file = retrieve_file (fd);
+      if (fd == STDIN_FILENO || file == NULL)
+        return -1;
+    }
 
-  elem = list_tail (&(thread_current()->open_files));
-  while ((elem = list_prev (elem)) != list_head (&(thread_current()->open_files)))
+  for (i = 0; i < iovcnt; i++)
     {
-      temp = list_next(elem);
-      file_desc = list_entry(elem, struct file_descriptor, elem);
-      if (file_desc->owner == tid)
+      off_t bytes_written;
+
+      if (file == NULL)
+        {
+          putbuf (iov[i].iov_base, iov[i].iov_len);
+          bytes_written = iov[i].iov_len;
+        }
+      else
+        bytes_written = file_write (file,
+                                    iov[i].iov_base, iov[i].iov_len);
+      total += bytes_written;
+      if (bytes_written < (off_t) iov[i].iov_len)
+        break;
+    }
+  return total;
+}
+
+/* Copies up to LENGTH bytes from file IN_FD to file OUT_FD,
+   starting at each one's current position and advancing both.
+   The data never passes through user memory.  Returns the number
+   of bytes copied, which is 0 at end of file, or -1 if either fd
+   is not an open file or both are the same fd, which has only
+   one position. */
+int
+sys_copy_range (int in_fd, int out_fd, unsigned length)
+{
+  struct file *in, *out;
+
+  if (in_fd == STDIN_FILENO || in_fd == STDOUT_FILENO
+      || out_fd == STDIN_FILENO || out_fd == STDOUT_FILENO
+      || in_fd == out_fd)
+    return -1;
+  if (length > INT32_MAX)
+    length = INT32_MAX;
+  in = retrieve_file (in_fd);
+  out = retrieve_file (out_fd);
+  if (in == NULL || out == NULL)
+    return -1;
+  return file_copy (out, in, length);
+}
+
+/* Fills in STATS with statistics for the block device that
+   plays ROLE, e.g. "filesys" or "swap", since boot.  Returns
+   false if no device plays ROLE.  The caller must have made sure
+   that ROLE and STATS are in user memory that is present. */
+bool
+sys_block_stats (const char *role, struct block_stats *stats)
+{
+  struct block_stats s;
+  enum block_type type;
+
+  for (type = 0; type < BLOCK_ROLE_CNT; type++)
+    if (!strcmp (role, block_type_name (type)))
+      break;
+  if (type == BLOCK_ROLE_CNT || block_get_role (type) == NULL)
+    return false;
+
+  block_get_stats (block_get_role (type), &s);
+  memcpy (stats, &s, sizeof *stats);
+  return true;
+}
+
+/* Makes sure that every page of the SIZE-byte user BUFFER is
+   present, so that the file system can copy into or out of
+   BUFFER directly.  Loads pages that are in the supplemental
+   page table but not yet in memory, and grows the stack for
+   pages just below the stack pointer, as the page fault handler
+   would.  Terminates the process if any part of BUFFER is not
+   valid user memory. */
+static void
+load_user_buffer (const void *buffer, unsigned size)
+{
+  struct thread *t = thread_current ();
+  const uint8_t *start = buffer;
+  const uint8_t *upage;
+
+  if (size == 0)
+    return;
+  if (!is_valid_uvaddr (buffer) || start + size < start
+      || !is_user_vaddr (start + size - 1))
+    sys_exit (-1);
+
+  for (upage = pg_round_down (buffer); upage < start + size; upage += PGSIZE)
+    if (pagedir_get_page (t->pagedir, upage) == NULL)
       {
-        list_remove(elem);
-        file_close(file_desc->file_struct);
-        free(file_desc);
+        const uint8_t *addr = upage > start ? upage : start;
+        struct sup_page_entry *spte;
+
+        spte = get_spe (&t->suppl_page_table, (void *) upage);
+        if (spte != NULL && !spte->loaded)
+          {
+            if (!load_page (spte))
+              sys_exit (-1);
+          }
+        else if (spte == NULL
+                 && addr >= (const uint8_t *) t->syscall_esp - 32
+                 && (const uint8_t *) PHYS_BASE - upage <= STACK_SIZE)
+          {
+            grow_stack ((void *) upage);
+            if (pagedir_get_page (t->pagedir, upage) == NULL)
+              sys_exit (-1);
+          }
+        else
+          sys_exit (-1);
       }
-      elem = temp;
-    }
 }
-void
-close_all_files (struct thread *t)
+
+/* Like load_user_buffer(), for the null-terminated string STR,
+   whose length is not known until it has been read. */
+static void
+load_user_string (const char *str)
 {
-  struct list_elem *e;
-  struct file_descriptor *fm;
+  load_user_buffer (str, 1);
+  while (*str != '\0')
+    if (pg_ofs (++str) == 0)
+      load_user_buffer (str, 1);
+}
 
-  e = list_begin (&t->children);
+/* Validates the user array of IOVCNT iovecs at IOV and every
+   buffer it describes, and returns IOV.  Terminates the process
+   if IOVCNT is out of range or any of the memory is invalid. */
+static const struct iovec *
+get_user_iov (const struct iovec *iov, int iovcnt)
+{
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    sys_exit (-1);
+  load_user_buffer (iov, iovcnt * sizeof *iov);
+  for (i = 0; i < iovcnt; i++)
+    load_user_buffer (iov[i].iov_base, iov[i].iov_len);
+  return iov;
+}
 
-  while (e != list_end (&t->children))
-    {
-      fm = list_entry (e, struct file_descriptor, elem);
-      // move to the next element to stop the loop getting confused
-      e = list_next (e);
+/* Returns the file open as FD in the current process, or a null
+   pointer if FD is not open.  The descriptor table is indexed by
+   fd, so this takes constant time. */
+struct file *
+retrieve_file (int fd)
+{
+  struct thread *t = thread_current ();
+
+  if (fd < 2 || fd >= t->fd_table_size)
+    return NULL;
+  return t->fd_table[fd];
+}
+
+/* Installs FILE in the lowest free slot of the current process's
+   file descriptor table, growing the table if it is full, and
+   returns the slot's fd.  Returns -1 if the table cannot grow. */
+static int
+alloc_fd (struct file *file)
+{
+  struct thread *t = thread_current ();
+  int fd;
+
+  for (fd = t->fd_lowest_free; fd < t->fd_table_size; fd++)
+    if (t->fd_table[fd] == NULL)
+      break;
 
-      file_close (fm->file_struct);
-      list_remove (&fm->elem);
-      free (fm);
+  if (fd >= t->fd_table_size)
+    {
+      int new_size = t->fd_table_size == 0 ? FD_TABLE_MIN
+                                           : t->fd_table_size * 2;
+      struct file **new_table;
+
+      if (new_size > FD_TABLE_MAX)
+        return -1;
+      new_table = realloc (t->fd_table, new_size * sizeof *new_table);
+      if (new_table == NULL)
+        return -1;
+      memset (new_table + t->fd_table_size, 0,
+              (new_size - t->fd_table_size) * sizeof *new_table);
+      t->fd_table = new_table;
+      t->fd_table_size = new_size;
     }
+
+  t->fd_table[fd] = file;
+  t->fd_lowest_free = fd + 1;
+  return fd;
+}
+
+/* Closes FD_NUM in the current process and frees its slot for
+   reuse. */
+void close_extra_files(int fd_num)
+{
+  struct thread *t = thread_current ();
+  struct file *file = retrieve_file (fd_num);
+
+  if (file == NULL)
+    return;
+  t->fd_table[fd_num] = NULL;
+  if (fd_num < t->fd_lowest_free)
+    t->fd_lowest_free = fd_num;
+  file_close (file);
+}
+
+/* Closes every file the current process, whose id is TID, has
+   open and frees its file descriptor table. */
+void
+close_thread_files(tid_t tid)
+{
+  struct thread *t = thread_current ();
+  int fd;
+
+  ASSERT (t->tid == tid);
+
+  for (fd = 2; fd < t->fd_table_size; fd++)
+    if (t->fd_table[fd] != NULL)
+      file_close (t->fd_table[fd]);
+  free (t->fd_table);
+  t->fd_table = NULL;
+  t->fd_table_size = 0;
+  t->fd_lowest_free = 2;
 }
 
 static bool is_valid_uvaddr(const void *uvaddr)
@@ -674,7 +899,7 @@ static bool is_valid_uvaddr(const void *uvaddr)
 mapid_t
 mmap (int fd, void *addr)
 {
-  struct file_descriptor *fd_struct;
+  struct file *file;
   int32_t len;
   struct thread *t = thread_current ();
   int offset;
@@ -686,12 +911,12 @@ mmap (int fd, void *addr)
   /* Bad fds*/
   if(fd == 0 || fd == 1)
     return -1;
-  fd_struct = retrieve_file(fd);
-  if (fd_struct == NULL)
+  file = retrieve_file(fd);
+  if (file == NULL)
     return -1;
 
   /* file length not equal to 0 */
-  len = file_length (fd_struct->file_struct);
+  len = file_length (file);
   if (len <= 0)
     return -1;
 
@@ -714,9 +939,7 @@ mmap (int fd, void *addr)
      semantic.
      If success, it will return the mapid;
      otherwise, return -1 */
-  lock_acquire (&filesys_lock);
-  struct file* newfile = file_reopen(fd_struct->file_struct);
-  lock_release (&filesys_lock);
+  struct file* newfile = file_reopen(file);
   return (newfile == NULL) ? -1 : mmfiles_insert (addr, newfile, len);
 }
 
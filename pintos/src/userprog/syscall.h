@@ -2,7 +2,8 @@
 #define USERPROG_SYSCALL_H
 #include "userprog/process.h"
 
-struct lock filesys_lock;
+struct iovec;
+struct block_stats;
 
 void sys_exit (int);
 void sys_halt(void);
@@ -17,6 +18,12 @@ unsigned sys_tell(int fd);
 void close_extra_files(int fd_num);
 void close_thread_files(tid_t tid);
 void sys_close(int fd);
+int sys_pread (int fd, void *buffer, unsigned size, unsigned position);
+int sys_pwrite (int fd, const void *buffer, unsigned size, unsigned position);
+int sys_readv (int fd, const struct iovec *iov, int iovcnt);
+int sys_writev (int fd, const struct iovec *iov, int iovcnt);
+int sys_copy_range (int in_fd, int out_fd, unsigned length);
+bool sys_block_stats (const char *role, struct block_stats *);
 static mapid_t mmap (int, void *);
 static void munmap (mapid_t);
 
@@ -166,5 +166,5 @@ next_frame_table_entry_to_clear()
 void
 save_evicted_page(struct frame_table_entry * next_fte_to_clear)
 {
-  // TODO
+  // TODO: swap the page out with vm_page_swap_out()
 }
@@ -209,8 +209,14 @@ load_page_swap (struct sup_page_entry *spte)
     return false;
   }
 
-  /* Swap data from disk into memory page */
-  vm_swap_in (spte->swap_slot_idx, spte->user_vaddr);
+  /* Swap data from disk into memory page.  Reading through the
+     kernel address lets the swap device's queue schedule the
+     read, so it can overlap file system I/O on the other disk.
+     A same-filled page was never written anywhere. */
+  if (spte->swap_filled)
+    vm_swap_fill (kpage, spte->swap_fill);
+  else
+    vm_swap_in (spte->swap_slot_idx, kpage);
 
   if (spte->type == SWAP)
   {
@@ -226,6 +232,22 @@ load_page_swap (struct sup_page_entry *spte)
   return true;
 }
 
+/* Swap out the page at KPAGE, which SPTE describes.  A page that
+   is one word repeated, such as a page of zeros, is only recorded
+   in SPTE, with no swap slot and no disk write; any other page
+   goes to a swap slot.  The caller marks SPTE's type as SWAP and
+   sets swap_writable.  Returns false if swap is full */
+bool
+vm_page_swap_out (struct sup_page_entry *spte, const void *kpage)
+{
+  spte->swap_filled = vm_swap_is_filled (kpage, &spte->swap_fill);
+  if (spte->swap_filled)
+    return true;
+
+  spte->swap_slot_idx = vm_swap_out (kpage);
+  return spte->swap_slot_idx != SWAP_ERROR;
+}
+
 /* Add an file suplemental page entry to supplemental page table */
 bool
 suppl_pt_insert_mmf (struct file *file, off_t ofs, uint8_t *upage,
@@ -41,6 +41,8 @@ struct sup_page_entry{
 
   size_t swap_slot_idx;
   bool swap_writable;
+  bool swap_filled;     /* swapped out without a slot, see swap_fill */
+  uint32_t swap_fill;   /* word the whole page was filled with */
 
   struct hash_elem elem;
 };
@@ -57,6 +59,7 @@ bool suppl_pt_less (const struct hash_elem *, const struct hash_elem *, void * U
 
 void free_sp(struct hash *);
 bool load_page(struct sup_page_entry *);
+bool vm_page_swap_out (struct sup_page_entry *, const void *);
 void grow_stack (void *);
 //void write_page_back_to_file_wo_lock (struct suppl_pte *spte);
 
@@ -1,5 +1,10 @@
 #include <bitmap.h>
+#include <lz.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
+#include "threads/palloc.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
 #include <stdbool.h>
@@ -18,6 +23,57 @@ static struct bitmap *swap_map;
 static size_t SECTORS_PER_PAGE = PGSIZE / BLOCK_SECTOR_SIZE;
 static size_t swap_size_in_page (void);
 
+/* Number of slots on the swap device */
+static size_t swap_slot_cnt;
+
+/* Compressed swap tier.
+
+   Before a page goes to the swap device, it is compressed, and
+   if it shrinks to ZSWAP_MAX_SIZE bytes or less it is kept in
+   the compressed pool instead: a fixed region of ZSWAP_PAGES
+   kernel pages, divided into ZSWAP_CHUNK-byte chunks, allocated
+   when the first page is stored.  A
+   compressed page takes up consecutive chunks, the first two
+   bytes of which hold its compressed size.  A page goes to disk
+   only if it doesn't compress well or the pool has no room.
+
+   A page in the pool is identified by a swap index past the
+   device's slots: swap_slot_cnt plus its first chunk.
+
+   Pages reach swap only through vm_page_swap_out(), which frame
+   eviction (save_evicted_page() in frame.c) does not call yet, so
+   until it does, neither this pool nor the swap device is used. */
+#define ZSWAP_PAGES 32
+#define ZSWAP_CHUNK 64
+#define ZSWAP_CHUNK_CNT (ZSWAP_PAGES * PGSIZE / ZSWAP_CHUNK)
+#define ZSWAP_MAX_SIZE (PGSIZE / 2)
+
+static uint8_t *zswap_pool;             /* Pool, or null if not set up. */
+static struct bitmap *zswap_map;        /* Chunks in use. */
+static bool zswap_disabled;             /* No memory for the pool? */
+
+/* Protects the pool, its map, the buffers, and the statistics
+   below. */
+static struct lock zswap_lock;
+static uint8_t zswap_buf[ZSWAP_MAX_SIZE];       /* Compressed data. */
+static uint16_t zswap_work[LZ_WORK_SIZE / 2];   /* For lz_compress(). */
+
+/* Statistics. */
+static unsigned long long zswap_store_cnt;      /* Pages stored in pool. */
+static unsigned long long zswap_store_bytes;    /* Their compressed size. */
+static unsigned long long zswap_reject_cnt;     /* Didn't compress enough. */
+static unsigned long long zswap_full_cnt;       /* Found the pool full. */
+static unsigned long long zswap_load_cnt;       /* Swapped in from pool. */
+static unsigned long long disk_load_cnt;        /* Swapped in from disk. */
+static unsigned long long filled_cnt;           /* Same-filled pages. */
+static unsigned long long zero_cnt;             /* Of those, zero pages. */
+static unsigned long long fill_load_cnt;        /* Same-filled swapped in. */
+
+static bool zswap_setup (void);
+static size_t zswap_store (const void *);
+static void zswap_load (size_t swap_idx, void *);
+static void zswap_free (size_t swap_idx);
+
 void
 vm_swap_init ()
 {
@@ -33,6 +89,10 @@ vm_swap_init ()
 
   /* initialize all bits to be true */
   bitmap_set_all (swap_map, true);
+  swap_slot_cnt = swap_size_in_page ();
+
+  /* the compressed pool is set up on first use */
+  lock_init (&zswap_lock);
 }
 
 /* Find an available swap slot and dump in the given page represented by UVA
@@ -41,20 +101,20 @@ vm_swap_init ()
 /* No inner synchronization, should be used with a sync machanism */
 size_t vm_swap_out (const void *uva)
 {
+  /* keep the page in the compressed pool, if it fits */
+  size_t swap_idx = zswap_store (uva);
+  if (swap_idx != SWAP_ERROR)
+    return swap_idx;
+
   /* find a swap slot and mark it in use */
-  size_t swap_idx = bitmap_scan_and_flip (swap_map, 0, 1, true);
+  swap_idx = bitmap_scan_and_flip (swap_map, 0, 1, true);
 
   if (swap_idx == BITMAP_ERROR)
     return SWAP_ERROR;
 
-  /* write the page of data to the swap slot */
-  size_t counter = 0;
-  while (counter < SECTORS_PER_PAGE)
-  {
-    block_write (swap_device, swap_idx * SECTORS_PER_PAGE + counter,
-                 uva + counter * BLOCK_SECTOR_SIZE);
-    counter++;
-  }
+  /* write the page of data to the swap slot, in one transfer */
+  block_write_multiple (swap_device, swap_idx * SECTORS_PER_PAGE,
+                        SECTORS_PER_PAGE, uva);
   return swap_idx;
 }
 
@@ -62,24 +122,212 @@ size_t vm_swap_out (const void *uva)
 void
 vm_swap_in (size_t swap_idx, void *uva)
 {
-  /* swap out the data from swap slot to mem page */
-  size_t counter = 0;
-  while (counter < SECTORS_PER_PAGE)
-  {
-    block_read (swap_device, swap_idx * SECTORS_PER_PAGE + counter,
-                uva + counter * BLOCK_SECTOR_SIZE);
-    counter++;
-  }
+  if (swap_idx >= swap_slot_cnt)
+    {
+      zswap_load (swap_idx, uva);
+      return;
+    }
+
+  /* swap out the data from swap slot to mem page, in one transfer */
+  block_read_multiple (swap_device, swap_idx * SECTORS_PER_PAGE,
+                       SECTORS_PER_PAGE, uva);
   /* free the corresponding swap slot bit in bitmap */
   bitmap_flip (swap_map, swap_idx);
+
+  lock_acquire (&zswap_lock);
+  disk_load_cnt++;
+  lock_release (&zswap_lock);
 }
 
 void vm_clear_swap_slot (size_t swap_idx)
 {
+  if (swap_idx >= swap_slot_cnt)
+    {
+      zswap_free (swap_idx);
+      return;
+    }
+
   /* free the corresponding swap slot bit in bitmap */
   bitmap_flip (swap_map, swap_idx);
 }
 
+/* Returns true if the page at PAGE consists of one 32-bit word
+   repeated, storing the word in *VALUE.  Swapping out such a page,
+   e.g. a freshly touched page of zeros, takes no slot and no I/O:
+   it is enough to remember VALUE and refill the page with
+   vm_swap_fill() when it is swapped back in. */
+bool
+vm_swap_is_filled (const void *page, uint32_t *value)
+{
+  const uint32_t *words = page;
+  size_t i;
+
+  for (i = 1; i < PGSIZE / sizeof *words; i++)
+    if (words[i] != words[0])
+      return false;
+
+  *value = words[0];
+  lock_acquire (&zswap_lock);
+  filled_cnt++;
+  if (*value == 0)
+    zero_cnt++;
+  lock_release (&zswap_lock);
+  return true;
+}
+
+/* Fills the page at PAGE with VALUE, swapping in a page for
+   which vm_swap_is_filled() returned true */
+void
+vm_swap_fill (void *page, uint32_t value)
+{
+  uint32_t *words = page;
+  size_t i;
+
+  if (value == 0)
+    memset (page, 0, PGSIZE);
+  else
+    for (i = 0; i < PGSIZE / sizeof *words; i++)
+      words[i] = value;
+
+  lock_acquire (&zswap_lock);
+  fill_load_cnt++;
+  lock_release (&zswap_lock);
+}
+
+/* Prints statistics about swapping, if there has been any */
+void
+vm_swap_print_stats (void)
+{
+  unsigned long long store_cnt = zswap_store_cnt;
+  unsigned long long load_cnt = zswap_load_cnt + disk_load_cnt;
+
+  if (store_cnt + zswap_reject_cnt + zswap_full_cnt + filled_cnt == 0)
+    return;
+
+  printf ("Swap: %llu same-filled pages (%llu of zeros) kept without "
+          "a slot, %llu swapped back in\n",
+          filled_cnt, zero_cnt, fill_load_cnt);
+
+  printf ("Swap: %llu pages compressed to %llu%% of their size, "
+          "%llu too big, %llu spilled to disk with the pool full\n",
+          store_cnt,
+          store_cnt > 0 ? zswap_store_bytes * 100 / (store_cnt * PGSIZE) : 0,
+          zswap_reject_cnt, zswap_full_cnt);
+  printf ("Swap: %llu of %llu pages swapped in from the compressed pool\n",
+          zswap_load_cnt, load_cnt);
+}
+
+/* Allocates the compressed pool, unless it is already set up.
+   Returns false, and disables the pool for good, if there is no
+   memory for it.  The caller must hold zswap_lock */
+static bool
+zswap_setup (void)
+{
+  if (zswap_pool != NULL)
+    return true;
+  if (zswap_disabled)
+    return false;
+
+  zswap_pool = palloc_get_multiple (0, ZSWAP_PAGES);
+  zswap_map = bitmap_create (ZSWAP_CHUNK_CNT);
+  if (zswap_pool == NULL || zswap_map == NULL)
+    {
+      printf ("swap: no memory for compressed pool\n");
+      palloc_free_multiple (zswap_pool, ZSWAP_PAGES);
+      bitmap_destroy (zswap_map);
+      zswap_pool = NULL;
+      zswap_map = NULL;
+      zswap_disabled = true;
+      return false;
+    }
+  return true;
+}
+
+/* Tries to store the page at PAGE in the compressed pool.
+   Returns its swap index if successful, otherwise SWAP_ERROR */
+static size_t
+zswap_store (const void *page)
+{
+  size_t chunk = BITMAP_ERROR;
+  size_t size;
+
+  lock_acquire (&zswap_lock);
+  if (!zswap_setup ())
+    {
+      lock_release (&zswap_lock);
+      return SWAP_ERROR;
+    }
+  size = lz_compress (page, PGSIZE, zswap_buf, sizeof zswap_buf,
+                      zswap_work);
+  if (size == 0)
+    zswap_reject_cnt++;
+  else
+    {
+      chunk = bitmap_scan_and_flip (zswap_map, 0,
+                                    DIV_ROUND_UP (size + 2, ZSWAP_CHUNK),
+                                    false);
+      if (chunk == BITMAP_ERROR)
+        zswap_full_cnt++;
+      else
+        {
+          uint8_t *p = zswap_pool + chunk * ZSWAP_CHUNK;
+          p[0] = size & 0xff;
+          p[1] = size >> 8;
+          memcpy (p + 2, zswap_buf, size);
+          zswap_store_cnt++;
+          zswap_store_bytes += size;
+        }
+    }
+  lock_release (&zswap_lock);
+
+  return chunk != BITMAP_ERROR ? swap_slot_cnt + chunk : SWAP_ERROR;
+}
+
+/* Returns the compressed page for SWAP_IDX in the pool, and
+   stores its compressed size in *SIZE.  The caller must hold
+   zswap_lock */
+static uint8_t *
+zswap_lookup (size_t swap_idx, size_t *size)
+{
+  uint8_t *p;
+
+  ASSERT (swap_idx - swap_slot_cnt < ZSWAP_CHUNK_CNT);
+  p = zswap_pool + (swap_idx - swap_slot_cnt) * ZSWAP_CHUNK;
+  *size = p[0] | (p[1] << 8);
+  return p;
+}
+
+/* Decompresses the page for SWAP_IDX from the pool into PAGE,
+   and frees it from the pool */
+static void
+zswap_load (size_t swap_idx, void *page)
+{
+  uint8_t *p;
+  size_t size;
+
+  lock_acquire (&zswap_lock);
+  p = zswap_lookup (swap_idx, &size);
+  if (!lz_decompress (p + 2, size, page, PGSIZE))
+    PANIC ("compressed swap page %zu is corrupt", swap_idx);
+  zswap_load_cnt++;
+  lock_release (&zswap_lock);
+
+  zswap_free (swap_idx);
+}
+
+/* Frees the page for SWAP_IDX from the pool */
+static void
+zswap_free (size_t swap_idx)
+{
+  size_t size;
+
+  lock_acquire (&zswap_lock);
+  zswap_lookup (swap_idx, &size);
+  bitmap_set_multiple (zswap_map, swap_idx - swap_slot_cnt,
+                       DIV_ROUND_UP (size + 2, ZSWAP_CHUNK), false);
+  lock_release (&zswap_lock);
+}
+
 /* Returns how many pages the swap device can contain, which is rounded down */
 static size_t
 swap_size_in_page ()
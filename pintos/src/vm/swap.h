@@ -1,6 +1,10 @@
 #ifndef EE468_PINTOS_PROJECT_3_SWAP_H
 #define EE468_PINTOS_PROJECT_3_SWAP_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #define SWAP_ERROR SIZE_MAX
 
 /* Swap initialization */
@@ -13,4 +17,13 @@ size_t vm_swap_out (const void *);
 void vm_swap_in (size_t, void *);
 
 void vm_clear_swap_slot (size_t);
+
+/* Check whether a page is one word repeated, which needs no slot */
+bool vm_swap_is_filled (const void *, uint32_t *);
+
+/* Fill a page with a repeated word, to swap such a page in */
+void vm_swap_fill (void *, uint32_t);
+
+/* Print swap statistics */
+void vm_swap_print_stats (void);
 #endif //EE468_PINTOS_PROJECT_3_SWAP_H